@@ -18,10 +18,10 @@
 #define boxWidth 120
 
 #define WIDTH SLIDER_WIDTH + boxWidth*2 + indent*3
-#define HEIGHT SLIDER_HEIGHT + 6*SLIDER_HEIGHT2 + indent*3 + textHeight*4
+#define HEIGHT SLIDER_HEIGHT + 6*SLIDER_HEIGHT2 + indent*4 + textHeight*7
 //==============================================================================
 Sjf_spectralProcessorAudioProcessorEditor::Sjf_spectralProcessorAudioProcessorEditor (Sjf_spectralProcessorAudioProcessor& p, juce::AudioProcessorValueTreeState& vts)
-    : AudioProcessorEditor (&p), audioProcessor (p), valueTreeState( vts )
+    : AudioProcessorEditor (&p), audioProcessor (p), valueTreeState( vts ), spectrumAnalyser( p.getAnalyserFifo(), p.getBandFrequencies() )
 {
     const int NUM_BANDS = audioProcessor.getNumBands();
     setLookAndFeel( &otherLookAndFeel );
@@ -42,6 +42,9 @@ Sjf_spectralProcessorAudioProcessorEditor::Sjf_spectralProcessorAudioProcessorEd
         m_canSavePreset = true;
     };
     
+    // spectrum sits on top of the gain sliders but lets the mouse through
+    addAndMakeVisible( &spectrumDisplay );
+    
     addAndMakeVisible( &polarityFlips );
     polarityFlips.setNumRows( 1 );
     polarityFlips.setNumColumns( NUM_BANDS );
@@ -207,6 +210,157 @@ Sjf_spectralProcessorAudioProcessorEditor::Sjf_spectralProcessorAudioProcessorEd
     filterOrderNumBox.setTooltip("This sets the order for all filters (higher order, steeper roll-off" );
     filterOrderNumBox.sendLookAndFeelChange();
     
+    addAndMakeVisible( &delayInterpolationBox );
+    delayInterpolationBox.addItem( "linear", 1 );
+    delayInterpolationBox.addItem( "allpass", 2 );
+    delayInterpolationBox.addItem( "cubic", 3 );
+    delayInterpolationBox.addItem( "lagrange", 4 );
+    delayInterpolationBoxAttachment.reset( new juce::AudioProcessorValueTreeState::ComboBoxAttachment ( valueTreeState, "delayInterpolation", delayInterpolationBox ) );
+    delayInterpolationBox.setTooltip( "This sets the interpolation used when reading from the delay lines (higher quality costs more cpu). \nOffline renders always use lagrange" );
+    delayInterpolationBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &delayStorageBox );
+    juce::String storageTooltip = "This sets the sample format the delay lines are stored in, smaller formats use less memory and bandwidth but add noise each time the signal goes round the feedback loop (offline renders always use float32). \nNoise added per pass (0dBFS / -60dBFS sine):";
+    for ( auto storage : { float32Storage, float16Storage, bfloat16Storage, int24Storage } )
+    {
+        static const std::array< juce::String, 4 > names { "float32", "float16", "bfloat16", "int24" };
+        auto noiseFloor = sjf_measureStorageNoiseFloor( storage );
+        delayStorageBox.addItem( names[ storage - 1 ], storage );
+        storageTooltip += "\n" + names[ storage - 1 ] + ": " + juce::String( noiseFloor.fullScaleDB, 1 ) + "dB / " + juce::String( noiseFloor.quietDB, 1 ) + "dB";
+    }
+    delayStorageBoxAttachment.reset( new juce::AudioProcessorValueTreeState::ComboBoxAttachment ( valueTreeState, "delayStorage", delayStorageBox ) );
+    delayStorageBox.setTooltip( storageTooltip );
+    delayStorageBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &maxDelayTimeNumBox );
+    maxDelayTimeNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "maxDelayTime", maxDelayTimeNumBox ) );
+    maxDelayTimeNumBox.setTextValueSuffix( "s max delay" );
+    maxDelayTimeNumBox.setTooltip( "This sets the longest delay time (in seconds) the delay time sliders can reach" );
+    maxDelayTimeNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &delayMemoryNumBox );
+    delayMemoryNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "delayMemory", delayMemoryNumBox ) );
+    delayMemoryNumBox.setTextValueSuffix( "MB delay memory" );
+    delayMemoryNumBox.setTooltip( "This sets how much memory (in megabytes) can be shared between the bands with their delays switched on. \nIf there isn't enough for the maximum delay time the longest delays will be shortened" );
+    delayMemoryNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &delayBudgetLabel );
+    delayBudgetLabel.setJustificationType( juce::Justification::centred );
+    delayBudgetLabel.setTooltip( "Shows whether every band with its delay switched on can reach the max delay time in the delay memory, and if not, how short the shortened bands are" );
+    
+    addAndMakeVisible( &auxRoutingBox );
+    auxRoutingBox.addItem( "aux out per band", 1 );
+    auxRoutingBox.addItem( "aux out per pair", 2 );
+    auxRoutingBox.addItem( "aux out per four", 3 );
+    auxRoutingBox.addItem( "aux out odd / even", 4 );
+    auxRoutingBoxAttachment.reset( new juce::AudioProcessorValueTreeState::ComboBoxAttachment ( valueTreeState, "auxRouting", auxRoutingBox ) );
+    auxRoutingBox.setTooltip( "This sets how the bands are grouped onto the aux output buses (switch the buses on in your host). \nEach band is sent to its bus after its gain, lfo and delay, whichever bands are chosen for the main output. \nMultirate is switched off while any aux output is enabled" );
+    auxRoutingBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &feedbackMatrixBox );
+    feedbackMatrixBox.addItem( "independent feedback", 1 );
+    feedbackMatrixBox.addItem( "householder feedback", 2 );
+    feedbackMatrixBox.addItem( "hadamard feedback", 3 );
+    feedbackMatrixBox.addItem( "custom feedback", 4 );
+    feedbackMatrixBoxAttachment.reset( new juce::AudioProcessorValueTreeState::ComboBoxAttachment ( valueTreeState, "feedbackMatrix", feedbackMatrixBox ) );
+    feedbackMatrixBox.setTooltip( "This sets how the delay feedback is shared between the bands. \nIndependent feeds each band's delay back into itself, householder and hadamard mix every band's feedback into every other band (bands with their delay switched off are left out). \nCustom uses a matrix saved with the plugin's state. \nThe feedback is always independent while multirate is on" );
+    feedbackMatrixBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &delayModRateNumBox );
+    delayModRateNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "delayModRate", delayModRateNumBox ) );
+    delayModRateNumBox.setTextValueSuffix( "Hz delay mod" );
+    delayModRateNumBox.setTooltip( "This sets the rate of the lfos that modulate the delay times. \nEach band's lfo runs a little faster or slower than this so they don't all move together" );
+    delayModRateNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &delayModDepthNumBox );
+    delayModDepthNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "delayModDepth", delayModDepthNumBox ) );
+    delayModDepthNumBox.setTextValueSuffix( "ms delay mod" );
+    delayModDepthNumBox.setTooltip( "This sets how far (in milliseconds) the lfos move the delay times, for chorus and flanging within each band. \n0 switches the modulation off" );
+    delayModDepthNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &delayModSpreadNumBox );
+    delayModSpreadNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "delayModSpread", delayModSpreadNumBox ) );
+    delayModSpreadNumBox.setTextValueSuffix( " cycles stereo delay mod spread" );
+    delayModSpreadNumBox.setTooltip( "This sets how far apart (in cycles) the left and right channels' delay lfos are. \n0 moves both channels together, 0.5 moves them in opposite directions" );
+    delayModSpreadNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &dynamicsModeBox );
+    dynamicsModeBox.addItem( "dynamics off", 1 );
+    dynamicsModeBox.addItem( "compress", 2 );
+    dynamicsModeBox.addItem( "expand", 3 );
+    dynamicsModeBoxAttachment.reset( new juce::AudioProcessorValueTreeState::ComboBoxAttachment ( valueTreeState, "dynamicsMode", dynamicsModeBox ) );
+    dynamicsModeBox.setTooltip( "This sets the dynamics applied to each band after it is filtered (and before its delay). \nCompress turns down the parts of a band above the threshold, expand turns down the parts below it" );
+    dynamicsModeBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &dynamicsDetectorBox );
+    dynamicsDetectorBox.addItem( "peak", 1 );
+    dynamicsDetectorBox.addItem( "rms", 2 );
+    dynamicsDetectorBoxAttachment.reset( new juce::AudioProcessorValueTreeState::ComboBoxAttachment ( valueTreeState, "dynamicsDetector", dynamicsDetectorBox ) );
+    dynamicsDetectorBox.setTooltip( "This sets whether each band's envelope follows its peak or rms level" );
+    dynamicsDetectorBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &dynamicsThresholdNumBox );
+    dynamicsThresholdNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "dynamicsThreshold", dynamicsThresholdNumBox ) );
+    dynamicsThresholdNumBox.setTextValueSuffix( "dB threshold" );
+    dynamicsThresholdNumBox.setTooltip( "This sets the level (in dB) each band's dynamics and envelope are measured against" );
+    dynamicsThresholdNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &dynamicsRatioNumBox );
+    dynamicsRatioNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "dynamicsRatio", dynamicsRatioNumBox ) );
+    dynamicsRatioNumBox.setTextValueSuffix( ":1 ratio" );
+    dynamicsRatioNumBox.setTooltip( "This sets how hard the compressor or expander works" );
+    dynamicsRatioNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &dynamicsAttackNumBox );
+    dynamicsAttackNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "dynamicsAttack", dynamicsAttackNumBox ) );
+    dynamicsAttackNumBox.setTextValueSuffix( "ms attack" );
+    dynamicsAttackNumBox.setTooltip( "This sets how quickly (in milliseconds) each band's envelope rises" );
+    dynamicsAttackNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &dynamicsReleaseNumBox );
+    dynamicsReleaseNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "dynamicsRelease", dynamicsReleaseNumBox ) );
+    dynamicsReleaseNumBox.setTextValueSuffix( "ms release" );
+    dynamicsReleaseNumBox.setTooltip( "This sets how quickly (in milliseconds) each band's envelope falls" );
+    dynamicsReleaseNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &envelopeTargetBox );
+    envelopeTargetBox.addItem( "envelope to nothing", 1 );
+    envelopeTargetBox.addItem( "envelope to lfo depth", 2 );
+    envelopeTargetBox.addItem( "envelope ducks feedback", 3 );
+    envelopeTargetBoxAttachment.reset( new juce::AudioProcessorValueTreeState::ComboBoxAttachment ( valueTreeState, "envelopeTarget", envelopeTargetBox ) );
+    envelopeTargetBox.setTooltip( "This lets each band's envelope (relative to the threshold) move something else in that band. \nLfo depth: quieter bands get less of their lfo. \nDucks feedback: louder bands get less delay feedback" );
+    envelopeTargetBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &envelopeAmountNumBox );
+    envelopeAmountNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "envelopeAmount", envelopeAmountNumBox ) );
+    envelopeAmountNumBox.setTextValueSuffix( " envelope amount" );
+    envelopeAmountNumBox.setTooltip( "This sets how much the envelopes move their target" );
+    envelopeAmountNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &vocoderToggle );
+    vocoderToggle.setButtonText( "vocoder" );
+    vocoderToggleAttachment.reset( new juce::AudioProcessorValueTreeState::ButtonAttachment ( valueTreeState, "vocoder", vocoderToggle ) );
+    vocoderToggle.setTooltip( "This splits the sidechain input into the same bands as the main input and uses each sidechain band's level to set the level of that band. \nSwitch the sidechain on in your host, this does nothing without it" );
+    vocoderToggle.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &vocoderSensitivityNumBox );
+    vocoderSensitivityNumBoxAttachment.reset( new juce::AudioProcessorValueTreeState::SliderAttachment ( valueTreeState, "vocoderSensitivity", vocoderSensitivityNumBox ) );
+    vocoderSensitivityNumBox.setTextValueSuffix( "dB vocoder sensitivity" );
+    vocoderSensitivityNumBox.setTooltip( "This sets how quiet (in dB) a sidechain band can be and still let its band through at full level" );
+    vocoderSensitivityNumBox.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &multirateToggle );
+    multirateToggle.setButtonText( "multirate" );
+    multirateToggleAttachment.reset( new juce::AudioProcessorValueTreeState::ButtonAttachment ( valueTreeState, "multirate", multirateToggle ) );
+    multirateToggle.setTooltip( "This runs the lower bands at reduced sample rates to save cpu, especially at high sample rates. \nThis adds latency, which is reported to the host. \nIt is switched off while any aux output is enabled" );
+    multirateToggle.sendLookAndFeelChange();
+    
+    addAndMakeVisible( &governorToggle );
+    governorToggle.setButtonText( "governor" );
+    governorToggleAttachment.reset( new juce::AudioProcessorValueTreeState::ButtonAttachment ( valueTreeState, "governor", governorToggle ) );
+    governorToggle.setTooltip( "When your computer struggles to keep up this steps the processing down to cheaper settings instead of letting the audio drop out, and back up again once there's room. \nFirst it stops filtering bands that can't be heard, then it lowers the filter order, and finally it uses linear delay interpolation. \nThe meters show how many steps down it is. Offline renders always run at full quality" );
+    governorToggle.sendLookAndFeelChange();
+    
     //------------------------------------------------------------
     //------------------------------------------------------------
     addAndMakeVisible( &randomAllButton );
@@ -340,28 +494,7 @@ Sjf_spectralProcessorAudioProcessorEditor::Sjf_spectralProcessorAudioProcessorEd
         m_selectedPreset = newSelection;
         
         audioProcessor.getPreset( m_selectedPreset );
-        std::array< float, 2 > pos;
-        switch( m_selectedPreset )
-        {
-            case 0:
-                pos[ 0 ] = pos[ 1 ] = 0;
-                break;
-            case 1:
-                pos[ 0 ] = 1;
-                pos[ 1 ] = 0;
-                break;
-            case 2:
-                pos[ 0 ] = 1;
-                pos[ 1 ] = 1;
-                break;
-            case 3:
-                pos[ 0 ] = 0;
-                pos[ 1 ] = 1;
-                break;
-        }
-        XYpad.setNormalisedPosition( pos );
-        xyPadXSlider.setValue( pos[0] );
-        xyPadYSlider.setValue( pos[1] );
+        moveXYPadToPreset( m_selectedPreset );
         
 //        m_canSavePreset = true;
     };
@@ -370,7 +503,12 @@ Sjf_spectralProcessorAudioProcessorEditor::Sjf_spectralProcessorAudioProcessorEd
     //------------------------------------------------------------
     //------------------------------------------------------------
     
-    setParameterValues();
+    addAndMakeVisible( &bandMeters );
+    audioProcessor.setMetricsEnabled( true );
+    //------------------------------------------------------------
+    //------------------------------------------------------------
+    
+    setParameterValues( Sjf_spectralProcessorAudioProcessor::allParameterGroups );
     
     
     startTimer( 200 );
@@ -387,6 +525,7 @@ Sjf_spectralProcessorAudioProcessorEditor::~Sjf_spectralProcessorAudioProcessorE
 {
     setLookAndFeel( nullptr );
     audioProcessor.isEditorOpen( false );
+    audioProcessor.setMetricsEnabled( false );
     DBG( "Finished deconstucting interface");
 }
 
@@ -434,6 +573,7 @@ void Sjf_spectralProcessorAudioProcessorEditor::paint (juce::Graphics& g)
 void Sjf_spectralProcessorAudioProcessorEditor::resized()
 {
     bandGainsMultiSlider.setBounds( indent, textHeight, SLIDER_WIDTH, SLIDER_HEIGHT);
+    spectrumDisplay.setBounds( bandGainsMultiSlider.getBounds() );
     polarityFlips.setBounds( bandGainsMultiSlider.getX(), bandGainsMultiSlider.getBottom(), SLIDER_WIDTH, textHeight );
     
     lfosOnOff.setBounds( polarityFlips.getX(), polarityFlips.getBottom()+indent, SLIDER_WIDTH, textHeight );
@@ -446,20 +586,47 @@ void Sjf_spectralProcessorAudioProcessorEditor::resized()
     feedbackMultiSlider.setBounds( delayTimeMultiSlider.getX(), delayTimeMultiSlider.getBottom(), SLIDER_WIDTH, SLIDER_HEIGHT2 );
     delayMixMultiSlider.setBounds( feedbackMultiSlider.getX(), feedbackMultiSlider.getBottom(), SLIDER_WIDTH, SLIDER_HEIGHT2 );
     
+    const int dynamicsWidth = SLIDER_WIDTH / 4;
+    dynamicsModeBox.setBounds( delayMixMultiSlider.getX(), delayMixMultiSlider.getBottom() + indent, dynamicsWidth, textHeight );
+    dynamicsDetectorBox.setBounds( dynamicsModeBox.getRight(), dynamicsModeBox.getY(), dynamicsWidth, textHeight );
+    dynamicsThresholdNumBox.setBounds( dynamicsDetectorBox.getRight(), dynamicsModeBox.getY(), dynamicsWidth, textHeight );
+    dynamicsRatioNumBox.setBounds( dynamicsThresholdNumBox.getRight(), dynamicsModeBox.getY(), dynamicsWidth, textHeight );
+    dynamicsAttackNumBox.setBounds( dynamicsModeBox.getX(), dynamicsModeBox.getBottom(), dynamicsWidth, textHeight );
+    dynamicsReleaseNumBox.setBounds( dynamicsAttackNumBox.getRight(), dynamicsAttackNumBox.getY(), dynamicsWidth, textHeight );
+    envelopeTargetBox.setBounds( dynamicsReleaseNumBox.getRight(), dynamicsAttackNumBox.getY(), dynamicsWidth, textHeight );
+    envelopeAmountNumBox.setBounds( envelopeTargetBox.getRight(), dynamicsAttackNumBox.getY(), dynamicsWidth, textHeight );
+    vocoderToggle.setBounds( dynamicsAttackNumBox.getX(), dynamicsAttackNumBox.getBottom(), dynamicsWidth, textHeight );
+    vocoderSensitivityNumBox.setBounds( vocoderToggle.getRight(), vocoderToggle.getY(), dynamicsWidth * 2, textHeight );
+    
     lfoTypeBox.setBounds( bandGainsMultiSlider.getRight()+indent, bandGainsMultiSlider.getY(), boxWidth, textHeight );
     bandsChoiceBox.setBounds( lfoTypeBox.getX(), lfoTypeBox.getBottom(), boxWidth, textHeight );
     filterDesignBox.setBounds( bandsChoiceBox.getX(), bandsChoiceBox.getBottom(), boxWidth, textHeight );
     filterOrderNumBox.setBounds( filterDesignBox.getX(), filterDesignBox.getBottom(), boxWidth, textHeight );
+    delayInterpolationBox.setBounds( filterOrderNumBox.getX(), filterOrderNumBox.getBottom(), boxWidth, textHeight );
+    multirateToggle.setBounds( randomAllButton.getX(), delayInterpolationBox.getY(), boxWidth, textHeight );
+    delayStorageBox.setBounds( delayInterpolationBox.getX(), delayInterpolationBox.getBottom(), boxWidth, textHeight );
+    maxDelayTimeNumBox.setBounds( multirateToggle.getX(), delayStorageBox.getY(), boxWidth, textHeight );
+    delayMemoryNumBox.setBounds( delayStorageBox.getX(), delayStorageBox.getBottom(), boxWidth * 2, textHeight );
+    delayBudgetLabel.setBounds( delayMemoryNumBox.getX(), delayMemoryNumBox.getBottom(), boxWidth * 2, textHeight );
     
     randomAllButton.setBounds( lfoTypeBox.getRight(), lfoTypeBox.getY(), boxWidth, textHeight*4 );
     
-    presets.setBounds( lfoTypeBox.getX(), filterOrderNumBox.getBottom() + indent, boxWidth*2, textHeight );
+    auxRoutingBox.setBounds( delayBudgetLabel.getX(), delayBudgetLabel.getBottom(), boxWidth, textHeight );
+    feedbackMatrixBox.setBounds( auxRoutingBox.getRight(), auxRoutingBox.getY(), boxWidth, textHeight );
+    delayModRateNumBox.setBounds( auxRoutingBox.getX(), auxRoutingBox.getBottom(), boxWidth, textHeight );
+    delayModDepthNumBox.setBounds( delayModRateNumBox.getRight(), delayModRateNumBox.getY(), boxWidth, textHeight );
+    delayModSpreadNumBox.setBounds( delayModRateNumBox.getX(), delayModRateNumBox.getBottom(), boxWidth * 2, textHeight );
+    
+    presets.setBounds( lfoTypeBox.getX(), delayModSpreadNumBox.getBottom() + indent, boxWidth*2, textHeight );
 //    auto xySliderSize = textHeight/2;
     XYpad.setBounds( presets.getX()+ indent, presets.getBottom(), boxWidth*2 - indent, boxWidth*2 - indent );
     xyPadXSlider.setBounds( XYpad.getX(), XYpad.getBottom(), XYpad.getWidth(), indent );
     xyPadYSlider.setBounds( lfoTypeBox.getX(), XYpad.getY(), indent, XYpad.getHeight() );
     
     tooltipsToggle.setBounds( randomAllButton.getX(), HEIGHT - textHeight - indent, boxWidth, textHeight );
+    governorToggle.setBounds( lfoTypeBox.getX(), tooltipsToggle.getY(), boxWidth, textHeight );
+    
+    bandMeters.setBounds( lfoTypeBox.getX(), xyPadXSlider.getBottom() + indent, boxWidth*2, tooltipsToggle.getY() - xyPadXSlider.getBottom() - indent*2 );
     
     tooltipLabel.setBounds( 0, HEIGHT, getWidth(), textHeight*5 );
 }
@@ -468,31 +635,126 @@ void Sjf_spectralProcessorAudioProcessorEditor::resized()
 void Sjf_spectralProcessorAudioProcessorEditor::timerCallback()
 {
     sjf_setTooltipLabel( this, MAIN_TOOLTIP, tooltipLabel );
+    updateDelayBudgetLabel();
+    updateMultirateToggle();
     
-    if( audioProcessor.checkIfParametersChanged() ) { setParameterValues(); }
-    audioProcessor.setParametersChangedFalse();
+    // a midi program change has already recalled the preset on the audio thread, this only shows it
+    auto midiPreset = audioProcessor.fetchMidiPreset();
+    if ( midiPreset >= 0 )
+    {
+        for ( int i = 0; i < presets.getNumButtons(); i++ ) { presets.setToggleState( 0, i, i == midiPreset ); }
+        m_selectedPreset = midiPreset;
+        moveXYPadToPreset( midiPreset );
+    }
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessorEditor::moveXYPadToPreset( const int preset )
+{
+    // each preset sits in a corner of the pad, moving the sliders moves the xy parameters with it
+    std::array< float, 2 > pos;
+    switch( preset )
+    {
+        case 0:
+            pos[ 0 ] = pos[ 1 ] = 0;
+            break;
+        case 1:
+            pos[ 0 ] = 1;
+            pos[ 1 ] = 0;
+            break;
+        case 2:
+            pos[ 0 ] = 1;
+            pos[ 1 ] = 1;
+            break;
+        case 3:
+            pos[ 0 ] = 0;
+            pos[ 1 ] = 1;
+            break;
+    }
+    XYpad.setNormalisedPosition( pos );
+    xyPadXSlider.setValue( pos[0] );
+    xyPadYSlider.setValue( pos[1] );
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessorEditor::updateMultirateToggle()
+{
+    // the parameter keeps its value, but the processor holds multirate off while the aux buses are enabled
+    const bool blocked = audioProcessor.hasAuxOutputs();
+    if ( multirateToggle.isEnabled() != blocked ) { return; }
+    multirateToggle.setEnabled( !blocked );
+    multirateToggle.setButtonText( blocked ? "multirate (off: aux)" : "multirate" );
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessorEditor::updateDelayBudgetLabel()
+{
+    // a band whose line is more than a sample short of the max delay time has been shortened to fit the budget
+    const float maxDelayTime = valueTreeState.getRawParameterValue( "maxDelayTime" )->load();
+    int numShortened = 0, numOff = 0;
+    float shortest = maxDelayTime;
+    for ( int b = 0; b < audioProcessor.getNumBands(); b++ )
+    {
+        if ( !audioProcessor.getDelayOn( b ) ) { continue; }
+        auto limit = audioProcessor.getDelayLimitSeconds( b );
+        if ( limit <= 0.0f ) { numOff++; }
+        else if ( limit < maxDelayTime ) { numShortened++; shortest = std::min( shortest, limit ); }
+    }
+    juce::String text = "all delays fit";
+    if ( numShortened > 0 || numOff > 0 )
+    {
+        text = "budget exceeded:";
+        if ( numShortened > 0 ) { text += " " + juce::String( numShortened ) + " shortened (to " + juce::String( shortest, 2 ) + "s at worst)"; }
+        if ( numOff > 0 ) { text += " " + juce::String( numOff ) + " off"; }
+    }
+    if ( delayBudgetLabel.getText() == text ) { return; }
+    delayBudgetLabel.setText( text, juce::dontSendNotification );
+    delayBudgetLabel.setColour( juce::Label::textColourId, ( numShortened > 0 || numOff > 0 ) ? juce::Colours::orange : juce::Colours::white );
+}
+
+
+
+void Sjf_spectralProcessorAudioProcessorEditor::displayRefresh()
+{
+    setParameterValues( audioProcessor.fetchChangedParameterGroups() );
+    
+    Sjf_spectralProcessorAudioProcessor::blockMetrics metrics;
+    while ( audioProcessor.popMetrics( metrics ) ) { bandMeters.addRecord( metrics ); }
+    bandMeters.update();
+    
+    sjf_spectrumAnalyser::spectrum inputSpectrum, outputSpectrum;
+    if ( spectrumAnalyser.getSpectra( inputSpectrum, outputSpectrum ) ) { spectrumDisplay.setSpectra( inputSpectrum, outputSpectrum ); }
     
 }
 
 
 
-void Sjf_spectralProcessorAudioProcessorEditor::setParameterValues()
+void Sjf_spectralProcessorAudioProcessorEditor::setParameterValues( const juce::uint32 changedGroups )
 {
+    if ( changedGroups == 0 ) { return; }
+    using processor = Sjf_spectralProcessorAudioProcessor;
     const int NUM_BANDS = audioProcessor.getNumBands();
     
+    // only touch (and so repaint) widgets whose value is actually different
+    auto setSlider = [ changedGroups ]( sjf_multislider& slider, const juce::uint32 group, const int band, const float value )
+    {
+        if ( ( changedGroups & group ) && slider.fetch( band ) != value ) { slider.setSliderValue( band, value ); }
+    };
+    auto setToggle = [ changedGroups ]( sjf_multitoggle& toggle, const juce::uint32 group, const int band, const bool state )
+    {
+        if ( ( changedGroups & group ) && toggle.fetch( 0, band ) != state ) { toggle.setToggleState( 0, band, state ); }
+    };
+    
     for (int b = 0; b < NUM_BANDS; b++)
     {
-        bandGainsMultiSlider.setSliderValue(b, audioProcessor.getBandGain(b) );
-        polarityFlips.setToggleState( 0, b, audioProcessor.getBandPolarity( b ) );
+        setSlider( bandGainsMultiSlider, processor::bandGainGroup, b, audioProcessor.getBandGain(b) );
+        setToggle( polarityFlips, processor::polarityGroup, b, audioProcessor.getBandPolarity( b ) );
         
-        lfosOnOff.setToggleState( 0, b, audioProcessor.getLfoOn( b ) );
-        lfoDepthMultiSlider.setSliderValue(b, audioProcessor.getLFODepth(b) );
-        lfoRateMultiSlider.setSliderValue(b, audioProcessor.getLFORate(b) );
-        lfoOffsetMultiSlider.setSliderValue(b, audioProcessor.getLFOOffset(b) );
+        setToggle( lfosOnOff, processor::lfoOnGroup, b, audioProcessor.getLfoOn( b ) );
+        setSlider( lfoDepthMultiSlider, processor::lfoDepthGroup, b, audioProcessor.getLFODepth(b) );
+        setSlider( lfoRateMultiSlider, processor::lfoRateGroup, b, audioProcessor.getLFORate(b) );
+        setSlider( lfoOffsetMultiSlider, processor::lfoOffsetGroup, b, audioProcessor.getLFOOffset(b) );
         
-        delaysOnOff.setToggleState( 0, b, audioProcessor.getDelayOn( b ) );
-        delayTimeMultiSlider.setSliderValue(b, audioProcessor.getDelayTime(b) );
-        feedbackMultiSlider.setSliderValue( b, audioProcessor.getFeedback(b) );
-        delayMixMultiSlider.setSliderValue( b, audioProcessor.getDelayMix(b) );
+        setToggle( delaysOnOff, processor::delayOnGroup, b, audioProcessor.getDelayOn( b ) );
+        setSlider( delayTimeMultiSlider, processor::delayTimeGroup, b, audioProcessor.getDelayTime(b) );
+        setSlider( feedbackMultiSlider, processor::feedbackGroup, b, audioProcessor.getFeedback(b) );
+        setSlider( delayMixMultiSlider, processor::delayMixGroup, b, audioProcessor.getDelayMix(b) );
     }
 }
@@ -12,6 +12,8 @@
 #include "PluginProcessor.h"
 #include "../sjf_audio/sjf_widgets.h"
 #include "../sjf_audio/sjf_LookAndFeel.h"
+#include "sjf_spectralMeters.h"
+#include "sjf_spectrumAnalyser.h"
 
 //==============================================================================
 /**
@@ -28,7 +30,11 @@ public:
 
 private:
     void timerCallback() override;
-    void setParameterValues();
+    void updateDelayBudgetLabel();
+    void updateMultirateToggle();
+    void moveXYPadToPreset( const int preset );
+    void displayRefresh();
+    void setParameterValues( const juce::uint32 changedGroups );
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -37,25 +43,32 @@ private:
     
     sjf_lookAndFeel otherLookAndFeel;
     
-    juce::ComboBox lfoTypeBox, bandsChoiceBox, filterDesignBox;
+    juce::ComboBox lfoTypeBox, bandsChoiceBox, filterDesignBox, delayInterpolationBox, delayStorageBox, auxRoutingBox, feedbackMatrixBox, dynamicsModeBox, dynamicsDetectorBox, envelopeTargetBox;
     juce::TextButton randomAllButton;
-    juce::ToggleButton tooltipsToggle;
+    juce::ToggleButton tooltipsToggle, multirateToggle, vocoderToggle, governorToggle;
     
-    juce::Label tooltipLabel;
+    juce::Label tooltipLabel, delayBudgetLabel;
     
     juce::Slider xyPadXSlider, xyPadYSlider;
     
     sjf_multislider bandGainsMultiSlider, lfoDepthMultiSlider, lfoRateMultiSlider, lfoOffsetMultiSlider, delayTimeMultiSlider, feedbackMultiSlider, delayMixMultiSlider;
     sjf_multitoggle polarityFlips, delaysOnOff, lfosOnOff, presets;
-    sjf_numBox filterOrderNumBox;
+    sjf_numBox filterOrderNumBox, maxDelayTimeNumBox, delayMemoryNumBox, delayModRateNumBox, delayModDepthNumBox, delayModSpreadNumBox, dynamicsThresholdNumBox, dynamicsRatioNumBox, dynamicsAttackNumBox, dynamicsReleaseNumBox, envelopeAmountNumBox, vocoderSensitivityNumBox;
     sjf_XYpad XYpad;
+    sjf_spectralMeters bandMeters;
+    sjf_spectrumAnalyser spectrumAnalyser;
+    sjf_spectrumDisplay spectrumDisplay;
     
     int m_selectedPreset = 0;
     bool m_canSavePreset = true;
-    std::unique_ptr< juce::AudioProcessorValueTreeState::ComboBoxAttachment > lfoTypeBoxAttachment, bandsChoiceBoxAttachment, filterDesignBoxAttachment;
-    std::unique_ptr< juce::AudioProcessorValueTreeState::SliderAttachment > filterOrderNumBoxAttachment;
+    std::unique_ptr< juce::AudioProcessorValueTreeState::ComboBoxAttachment > lfoTypeBoxAttachment, bandsChoiceBoxAttachment, filterDesignBoxAttachment, delayInterpolationBoxAttachment, delayStorageBoxAttachment, auxRoutingBoxAttachment, feedbackMatrixBoxAttachment, dynamicsModeBoxAttachment, dynamicsDetectorBoxAttachment, envelopeTargetBoxAttachment;
+    std::unique_ptr< juce::AudioProcessorValueTreeState::SliderAttachment > filterOrderNumBoxAttachment, maxDelayTimeNumBoxAttachment, delayMemoryNumBoxAttachment, delayModRateNumBoxAttachment, delayModDepthNumBoxAttachment, delayModSpreadNumBoxAttachment, dynamicsThresholdNumBoxAttachment, dynamicsRatioNumBoxAttachment, dynamicsAttackNumBoxAttachment, dynamicsReleaseNumBoxAttachment, envelopeAmountNumBoxAttachment, vocoderSensitivityNumBoxAttachment;
+    std::unique_ptr< juce::AudioProcessorValueTreeState::ButtonAttachment > multirateToggleAttachment, vocoderToggleAttachment, governorToggleAttachment;
     std::unique_ptr< juce::AudioProcessorValueTreeState::SliderAttachment > xyPadXSliderAttachment, xyPadYSliderAttachment;
     juce::String MAIN_TOOLTIP = "sjf_spectralProcessor: \n16 band graphic EQ with LFO modulation for gain and feedback delay lines for each band... \nNot designed for functional equalisation, but for sound design\n";
     
+    // checks for changed parameters and new meter data once per display refresh, declared last so it goes before the widgets it updates
+    juce::VBlankAttachment displayRefreshAttachment { this, [this] { displayRefresh(); } };
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Sjf_spectralProcessorAudioProcessorEditor)
 };
@@ -14,14 +14,7 @@
 //==============================================================================
 Sjf_spectralProcessorAudioProcessor::Sjf_spectralProcessorAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       )
+     : AudioProcessor ( createBusesProperties() )
 #endif
 , parameters(*this, nullptr, juce::Identifier("sjf_spectralProcessor"), createParameterLayout() )
 {
@@ -29,51 +22,69 @@ Sjf_spectralProcessorAudioProcessor::Sjf_spectralProcessorAudioProcessor()
     bandsParameter = parameters.getRawParameterValue("bands");
     filterDesignParameter = parameters.getRawParameterValue("filterDesign");
     filterOrderParameter = parameters.getRawParameterValue("filterOrder");
+    delayInterpolationParameter = parameters.getRawParameterValue("delayInterpolation");
+    delayStorageParameter = parameters.getRawParameterValue("delayStorage");
+    maxDelayTimeParameter = parameters.getRawParameterValue("maxDelayTime");
+    delayMemoryParameter = parameters.getRawParameterValue("delayMemory");
+    multirateParameter = parameters.getRawParameterValue("multirate");
+    auxRoutingParameter = parameters.getRawParameterValue("auxRouting");
+    feedbackMatrixParameter = parameters.getRawParameterValue("feedbackMatrix");
+    delayModRateParameter = parameters.getRawParameterValue("delayModRate");
+    delayModDepthParameter = parameters.getRawParameterValue("delayModDepth");
+    delayModSpreadParameter = parameters.getRawParameterValue("delayModSpread");
+    dynamicsModeParameter = parameters.getRawParameterValue("dynamicsMode");
+    dynamicsDetectorParameter = parameters.getRawParameterValue("dynamicsDetector");
+    dynamicsThresholdParameter = parameters.getRawParameterValue("dynamicsThreshold");
+    dynamicsRatioParameter = parameters.getRawParameterValue("dynamicsRatio");
+    dynamicsAttackParameter = parameters.getRawParameterValue("dynamicsAttack");
+    dynamicsReleaseParameter = parameters.getRawParameterValue("dynamicsRelease");
+    envelopeTargetParameter = parameters.getRawParameterValue("envelopeTarget");
+    envelopeAmountParameter = parameters.getRawParameterValue("envelopeAmount");
+    vocoderParameter = parameters.getRawParameterValue("vocoder");
+    vocoderSensitivityParameter = parameters.getRawParameterValue("vocoderSensitivity");
+    governorParameter = parameters.getRawParameterValue("governor");
+    for ( auto id : { "delayStorage", "maxDelayTime", "delayMemory", "multirate" } ) { parameters.addParameterListener( id, this ); }
     xParameter = parameters.getRawParameterValue("xyPad-X");
     yParameter = parameters.getRawParameterValue("xyPad-Y");
+    xyParameters = { parameters.getParameter("xyPad-X"), parameters.getParameter("xyPad-Y") };
     
-    auto SR = getSampleRate();
-    initialiseFilters( SR );
-    initialiseDelayLines( SR );
-    initialiseLFOs( SR );
-    initialiseSmoothers( SR );
-    initialiseDCBlock( SR );
-
-    
-    for ( int b = 0; b < NUM_BANDS; b++ )
+    // nothing is sized or designed until prepareToPlay knows the sample rate, construction only sets the defaults
+    m_bandGains.fill( 1.0f );
+    for ( auto* values : { &m_lfoRates, &m_lfoDepths, &m_lfoOffsets, &m_delayTimes, &m_feedbacks, &m_delayMix } ) { values->fill( 0.5f ); }
+    for ( auto& preset : m_bandGainsPresets ) { preset.fill( 1.0f ); }
+    for ( auto* presets : { &m_lfoRatesPresets, &m_lfoDepthsPresets, &m_lfoOffsetsPresets, &m_delayTimesPresets, &m_feedbacksPresets, &m_delayMixPresets } )
     {
-        for (int c = 0; c < 2; c++ ) { m_delayLines[ c ][ b ].clearDelayline(); }
-        
-        m_bandGains[ b ] = 1.0f;
-        m_lfoRates[ b ] = 0.5f;
-        m_lfoDepths[ b ] = 0.5f;
-        m_lfoOffsets[ b ] = 0.5f;
-        m_delayTimes[ b ] = 0.5f;
-        m_feedbacks[ b ] = 0.5f;
-        m_delayMix[ b ] = 0.5f;
-        
-        for ( int i = 0; i < m_bandGainsPresets.size(); i++ )
-        {
-            m_bandGainsPresets[ i ][ b ] = 1.0f;
-            m_polarityPresets[ i ][ b ] = false;
-            m_lfoRatesPresets[ i ][ b ] = 0.5f;
-            m_lfoDepthsPresets[ i ][ b ] = 0.5f;
-            m_lfoOffsetsPresets[ i ][ b ] = 0.5f;
-            m_delayTimesPresets[ i ][ b ] = 0.5f;
-            m_feedbacksPresets[ i ][ b ] = 0.5f;
-            m_delayMixPresets[ i ][ b ] = 0.5f;
-        }
-        
-        m_polarites[ b ] = false;
-        m_delaysOnOff[ b ] = false;
-        m_lfosOnOff[ b ] = false;
+        for ( auto& preset : *presets ) { preset.fill( 0.5f ); }
     }
+    for ( auto& preset : m_polarityPresets ) { preset.fill( false ); }
+    
+    // passes xy pad moves made over midi on to the parameters, resizes the delay lines and builds the static kernel
+    startTimerHz( 30 );
     
     DBG( "Finished Initialisation" );
 }
 
+//==============================================================================
+juce::AudioProcessor::BusesProperties Sjf_spectralProcessorAudioProcessor::createBusesProperties()
+{
+    auto properties = BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain",  juce::AudioChannelSet::stereo(), false)
+                      #endif
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                     #endif
+                       ;
+    // off until the host asks for them
+    for ( int b = 0; b < NUM_BANDS; b++ ) { properties = properties.withOutput( "Aux " + juce::String( b + 1 ), juce::AudioChannelSet::stereo(), false ); }
+    return properties;
+}
+
 Sjf_spectralProcessorAudioProcessor::~Sjf_spectralProcessorAudioProcessor()
 {
+    for ( auto id : { "delayStorage", "maxDelayTime", "delayMemory", "multirate" } ) { parameters.removeParameterListener( id, this ); }
+    stopTimer();
 }
 
 //==============================================================================
@@ -111,7 +122,7 @@ bool Sjf_spectralProcessorAudioProcessor::isMidiEffect() const
 
 double Sjf_spectralProcessorAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return m_tailLengthSeconds.load();
 }
 
 int Sjf_spectralProcessorAudioProcessor::getNumPrograms()
@@ -143,12 +154,58 @@ void Sjf_spectralProcessorAudioProcessor::prepareToPlay (double sampleRate, int
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    initialiseFilters( sampleRate );
+    // the filter table, multirate tree and scratch buffers only depend on the sample rate and block size,
+    // hosts often prepare again with the same settings so they are only rebuilt when those change
+    const bool configurationChanged = sampleRate != m_preparedSampleRate || samplesPerBlock != m_maxBlockSize;
+    // the message thread reads the prepared rate, block size, kernel level and filter table under this lock when it builds the static kernel
+    const juce::ScopedLock lock( getCallbackLock() );
+    // the profile is only switched here, so nothing is reallocated or cleared part way through a render.
+    // A host that switches to offline without preparing again keeps the realtime profile until it does
+    m_renderQuality = isNonRealtime();
+    selectKernels();
+    updateAuxOutputs();
+    updateSidechain();
+    if ( configurationChanged )
+    {
+        initialiseMultirate( sampleRate );
+        initialiseFilters( sampleRate );
+    }
+    m_preparedSampleRate = sampleRate;
+    // clears the filter states and the multirate tree
+    setMultirate( getMultirateSetting() );
     initialiseDelayLines( sampleRate );
     initialiseLFOs( sampleRate );
     initialiseSmoothers( sampleRate );
     initialiseDCBlock( sampleRate );
+    m_silenceDetector.initialise( sampleRate );
     
+    if ( configurationChanged )
+    {
+        m_analyserFifo.initialise( sampleRate, samplesPerBlock );
+        
+        m_maxBlockSize = samplesPerBlock;
+        auto framesSize = (size_t)( samplesPerBlock * NUM_BANDS );
+        for ( auto* frames : { &m_gainFrames, &m_delayTimeFrames, &m_feedbackFrames, &m_delayWetFrames, &m_delayDryFrames, &m_envelopeFrames } ) { frames->resize( framesSize ); }
+        for ( auto& frames : m_bandFrames ) { frames.resize( framesSize ); }
+        for ( auto& frames : m_delayModFrames ) { frames.resize( framesSize ); }
+        for ( auto& frames : m_sidechainFrames ) { frames.resize( framesSize ); }
+        m_vocoderFrames.resize( framesSize );
+        m_unityFrames.assign( framesSize, 1.0f );
+        for ( auto& frames : m_staticFrames ) { frames.resize( (size_t)samplesPerBlock ); }
+        m_silence.assign( (size_t)samplesPerBlock, 0.0f );
+        for ( auto& frames : m_levelFrames ) { frames.resize( (size_t)( samplesPerBlock * ( MAX_MULTIRATE_LEVELS + 1 ) ) ); }
+    }
+    m_bandDynamics.reset();
+    m_vocoderEnvelopes.reset();
+    // the kernel is rebuilt for the new rate / block size once the chain settles again
+    m_staticKernel.reset();
+    m_staticRequested = m_staticInput = m_gainsSettled = false;
+    m_chainTailSamples = m_staticTailSamples = 0;
+    // everything has just been reset, so the channels start out the same
+    m_channelsLinked = false;
+    m_identicalSamples = std::numeric_limits< juce::int64 >::max() / 2;
+    m_hostSampleCount = 0;
+    m_samplesUntilJitter = 0;
 }
 
 void Sjf_spectralProcessorAudioProcessor::releaseResources()
@@ -157,6 +214,12 @@ void Sjf_spectralProcessorAudioProcessor::releaseResources()
     // spare memory, etc.
 }
 
+void Sjf_spectralProcessorAudioProcessor::processorLayoutsChanged()
+{
+    updateAuxOutputs();
+    updateSidechain();
+}
+
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool Sjf_spectralProcessorAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
@@ -178,6 +241,20 @@ bool Sjf_spectralProcessorAudioProcessor::isBusesLayoutSupported (const BusesLay
         return false;
    #endif
 
+    // so can the sidechain
+    for ( int bus = 1; bus < layouts.inputBuses.size(); bus++ )
+    {
+        auto set = layouts.inputBuses[ bus ];
+        if ( !set.isDisabled() && set != juce::AudioChannelSet::mono() && set != juce::AudioChannelSet::stereo() ) { return false; }
+    }
+
+    // aux outputs can be switched off, mono or stereo
+    for ( int bus = 1; bus < layouts.outputBuses.size(); bus++ )
+    {
+        auto set = layouts.outputBuses[ bus ];
+        if ( !set.isDisabled() && set != juce::AudioChannelSet::mono() && set != juce::AudioChannelSet::stereo() ) { return false; }
+    }
+
     return true;
   #endif
 }
@@ -186,6 +263,7 @@ bool Sjf_spectralProcessorAudioProcessor::isBusesLayoutSupported (const BusesLay
 void Sjf_spectralProcessorAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    const auto blockStartTicks = juce::Time::getHighResolutionTicks();
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -199,25 +277,193 @@ void Sjf_spectralProcessorAudioProcessor::processBlock (juce::AudioBuffer<float>
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    if ( !m_editorOpenFlag )
+    if ( m_maxBlockSize <= 0 || totalNumInputChannels <= 0 )
     {
-        std::array< float, 2 > nPos = { *xParameter, *yParameter };
-        std::array< float, 4 > corners;
-        corners[0] = std::sqrt( std::pow(nPos[0], 2) + std::pow(nPos[1], 2) );
-        corners[1] = std::sqrt( std::pow(1.0f - nPos[0], 2) + std::pow(nPos[1], 2) );
-        corners[2] = std::sqrt( std::pow(1.0f - nPos[0], 2) + std::pow(1.0f - nPos[1], 2) );
-        corners[3] = std::sqrt( std::pow(nPos[0], 2) + std::pow(1.0f - nPos[1], 2) );
-        for ( int i = 0; i < corners.size(); i++ )
+        jassertfalse; // processBlock called before prepareToPlay
+        buffer.clear();
+        return;
+    }
+    // a single nan or inf would stay in the filter and delay states for good, so they are silenced on the way in.
+    // Checked on the bits, fast math is free to assume std::isfinite is always true
+    for ( int channel = 0; channel < totalNumInputChannels; channel++ )
+    {
+        auto* samples = buffer.getWritePointer( channel );
+        for ( int i = 0; i < bufferSize; i++ )
         {
-            corners[i] = std::fmax( 0, 1.0f - corners[i] );
+            juce::uint32 bits;
+            std::memcpy( &bits, samples + i, sizeof( bits ) );
+            if ( ( bits & 0x7f800000u ) == 0x7f800000u ) { samples[ i ] = 0.0f; }
         }
-        
-        DBG("CORNERS PROCESS BLOACK " << corners[ 0 ] << " " << corners[ 1 ] << " " << corners[ 2 ] << " " << corners[ 3 ]);
-        interpolatePresets( corners );
     }
-    
-    std::array< float, NUM_BANDS > lfoDepths, bandGainTargets, feedbackTarget, delayTimeTarget;
-    std::array< bool, NUM_BANDS > polarityFlip, lfoOn, delayOn;
+
+    // settings made on the message thread since the last block, nothing else writes the arrays the bands read from
+    juce::uint32 changedGroups = 0;
+    m_bandChanges.apply( [ this, &changedGroups ]( const int field, const int band, const float value ) { changedGroups |= writeBandValue( field, band, value ); } );
+    markParametersChanged( changedGroups );
+
+    // only when the pad has moved, so band gains set over midi aren't pulled straight back to the presets
+    if ( !m_editorOpenFlag && ( getPadPosition( 0 ) != m_interpolatedXY[ 0 ] || getPadPosition( 1 ) != m_interpolatedXY[ 1 ] ) ) { interpolateXY(); }
+
+    // skip the whole chain while asleep, any non-zero input wakes it straight away
+    // the sidechain only shapes the main input, it can't make any sound on its own
+    const int numMainInputChannels = juce::jmax( getMainBusNumInputChannels(), 1 );
+    const bool inputIsSilent = sjf_silenceDetector::inputIsSilent( buffer, numMainInputChannels, 0, bufferSize );
+    if ( m_silenceDetector.isSleeping() )
+    {
+        if ( inputIsSilent )
+        {
+            // still follow the midi so the next sound starts from the right settings
+            for ( const auto event : midiMessages ) { handleMidiEvent( event.data, event.numBytes ); }
+            buffer.clear();
+            return;
+        }
+        m_silenceDetector.wake();
+    }
+
+    // offline renders have no deadline to meet
+    const bool governed = *governorParameter > 0.5f && !isNonRealtime();
+    if ( !governed && m_governor.getLevel() != sjf_qualityGovernor::full ) { m_governor.reset(); }
+    m_qualityLevel = governed ? m_governor.getLevel() : (int)sjf_qualityGovernor::full;
+    // switching moves the filters over to the coefficients for their new rates, this only happens when the user toggles it
+    const bool multirate = getMultirateSetting();
+    if ( multirate != m_multirateActive ) { setMultirate( multirate ); }
+
+#if SJF_SPECTRAL_METRICS
+    m_collectMetrics = m_metricsEnabled.load();
+    auto controlStartTicks = juce::Time::getHighResolutionTicks();
+    if ( m_collectMetrics )
+    {
+        m_metrics = {};
+        m_measuredSamples = 0;
+        m_metrics.numSamples = bufferSize;
+        m_metrics.deadlineSeconds = bufferSize / getSampleRate();
+        m_metrics.qualityLevel = m_qualityLevel;
+    }
+#endif
+
+    calculateTargets();
+
+#if SJF_SPECTRAL_METRICS
+    if ( m_collectMetrics )
+    {
+        for ( int b = m_targets.bandStart; b < NUM_BANDS; b += m_targets.bandIncrement )
+        {
+            if ( m_targets.gain[ b ] != 0.0f ) { m_metrics.activeBands |= ( 1u << b ); }
+        }
+        m_metrics.stageSeconds[ blockMetrics::control ] += juce::Time::highResolutionTicksToSeconds( juce::Time::getHighResolutionTicks() - controlStartTicks );
+    }
+#endif
+
+    // only the main bus, any aux buses come after it in the buffer
+    const int numChannels = juce::jmin( getMainBusNumOutputChannels(), (int)m_filters.size() );
+    // sub blocks also end at each midi event, so the event lands on its exact sample
+    auto midiEvent = midiMessages.begin();
+    int startSample = 0;
+    while ( startSample < bufferSize )
+    {
+        bool targetsChanged = false;
+        for ( ; midiEvent != midiMessages.end() && (*midiEvent).samplePosition <= startSample; ++midiEvent )
+        {
+            auto event = *midiEvent;
+            targetsChanged |= handleMidiEvent( event.data, event.numBytes );
+        }
+        if ( targetsChanged ) { calculateTargets(); }
+        auto nextEvent = midiEvent != midiMessages.end() ? juce::jmin( (*midiEvent).samplePosition, bufferSize ) : bufferSize;
+        auto numSamples = juce::jmin( m_maxBlockSize, nextEvent - startSample );
+        processSubBlock( buffer, startSample, numSamples, numChannels, numMainInputChannels );
+        startSample += numSamples;
+    }
+    // anything stamped past the end of the block still counts
+    for ( ; midiEvent != midiMessages.end(); ++midiEvent )
+    {
+        auto event = *midiEvent;
+        handleMidiEvent( event.data, event.numBytes );
+    }
+#if JUCE_DEBUG
+    checkForBadValues( buffer, numChannels );
+#endif
+
+#if SJF_SPECTRAL_METRICS
+    if ( m_collectMetrics )
+    {
+        auto numMeasured = (float)juce::jmax( m_measuredSamples, 1 );
+        for ( int b = 0; b < NUM_BANDS; b++ )
+        {
+            m_metrics.bandRms[ b ] = std::sqrt( m_metrics.bandRms[ b ] / numMeasured );
+            m_metrics.feedbackEnergy[ b ] /= numMeasured;
+        }
+        m_metricsFifo.push( m_metrics );
+    }
+#endif
+
+    float outputPeak = 0.0f;
+    for ( int channel = 0; channel < totalNumOutputChannels; channel++ )
+    {
+        outputPeak = std::fmax( outputPeak, buffer.getMagnitude( channel, 0, bufferSize ) );
+    }
+    if ( m_silenceDetector.update( inputIsSilent, outputPeak, bufferSize ) )
+    {
+        // everything has decayed, clear what is left so we wake up from a clean state
+        for ( auto& delay : m_delays ) { delay.clear(); }
+        for ( auto& tree : m_multirateTrees ) { tree.reset(); }
+        if ( m_staticKernel != nullptr && m_staticKernel->convolution != nullptr ) { m_staticKernel->convolution->reset(); }
+        resetChain();
+        buffer.clear();
+    }
+    if ( governed ) { m_governor.update( juce::Time::highResolutionTicksToSeconds( juce::Time::getHighResolutionTicks() - blockStartTicks ), bufferSize / getSampleRate() ); }
+}
+//==============================================================================
+#if JUCE_DEBUG
+void Sjf_spectralProcessorAudioProcessor::checkForBadValues( const juce::AudioBuffer< float >& buffer, const int numChannels )
+{
+    // anything an optimised path gets wrong tends to show up as a nan / inf, or as denormals building up in the recursive state
+    auto isBad = []( float x ) { return !std::isfinite( x ) || ( x != 0.0f && std::abs( x ) < std::numeric_limits< float >::min() ); };
+    for ( int channel = 0; channel < numChannels; channel++ )
+    {
+        auto output = buffer.getReadPointer( channel );
+        for ( int i = 0; i < buffer.getNumSamples(); i++ ) { jassert( !isBad( output[ i ] ) ); }
+        // the cascades' state is sjf_audio's own, a bad state shows up in the band frames first
+        for ( auto x : m_bandFrames[ channel ] ) { jassert( !isBad( x ) ); }
+    }
+}
+#endif
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::selectKernels()
+{
+    m_kernelLevel = sjf_cpuDispatch::getLevel();
+    switch ( m_kernelLevel )
+    {
+#if SJF_X86_DISPATCH
+        case sjf_cpuDispatch::avx512:
+            m_controlProcessor = &Sjf_spectralProcessorAudioProcessor::calculateControlFramesAVX512;
+            m_sumProcessor = &Sjf_spectralProcessorAudioProcessor::sumBandsAVX512;
+            break;
+        case sjf_cpuDispatch::avx2:
+            m_controlProcessor = &Sjf_spectralProcessorAudioProcessor::calculateControlFramesAVX2;
+            m_sumProcessor = &Sjf_spectralProcessorAudioProcessor::sumBandsAVX2;
+            break;
+#endif
+        default:
+            m_controlProcessor = &Sjf_spectralProcessorAudioProcessor::calculateControlFramesBaseline;
+            m_sumProcessor = &Sjf_spectralProcessorAudioProcessor::sumBandsBaseline;
+            break;
+    }
+    // the filter kernel is picked along with the coefficients
+    m_filterOrder = 0;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::calculateTargets()
+{
+    const float maxDelaySamples = *maxDelayTimeParameter * (float)getSampleRate();
+    const float delayModRate = *delayModRateParameter;
+    m_targets.delayModDepth = *delayModDepthParameter * 0.001f * (float)getSampleRate();
+    m_targets.delayModSpread = *delayModSpreadParameter;
+    m_vocoderActive = *vocoderParameter > 0.5f && m_sidechainNumChannels > 0;
+    if ( m_vocoderActive ) { m_vocoderEnvelopes.setParameters( sjf_bandDynamics< NUM_BANDS >::off, sjf_bandDynamics< NUM_BANDS >::rms, -*vocoderSensitivityParameter, 1.0f, VOCODER_ATTACK_MS, VOCODER_RELEASE_MS, getSampleRate(), {}, m_renderQuality ); }
+    m_bandDynamics.setParameters( (int)*dynamicsModeParameter, (int)*dynamicsDetectorParameter, *dynamicsThresholdParameter, *dynamicsRatioParameter, *dynamicsAttackParameter, *dynamicsReleaseParameter, getSampleRate(), m_bandTickMasks, m_renderQuality );
+    // lfo depth can only follow the envelopes at the block rate, it's set before the bands are filtered
+    const bool envelopeToLfo = (int)*envelopeTargetParameter == sjf_bandDynamics< NUM_BANDS >::lfoDepthTarget;
+    const float envelopeAmount = *envelopeAmountParameter;
     for ( int b = 0; b < NUM_BANDS; b++ )
     {
         auto r = ( 0.01f * std::pow( 2000.0f, m_lfoRates[ b ] ) );
@@ -227,92 +473,819 @@ void Sjf_spectralProcessorAudioProcessor::processBlock (juce::AudioBuffer<float>
         int lfotyp = *lfoTypeParameter;
         if ( lfotyp == 2 ){ lfotyp = sjf_lfo::lfoType::noise2; }
         m_lfos[ b ].setLFOtype( lfotyp );
-        
-        lfoDepths[ b ] = std::sqrt(m_lfoDepths[ b ]) * 5.0f;
-        bandGainTargets[ b ] = m_bandGains[ b ];
-        
+
+        m_targets.lfoDepth[ b ] = std::sqrt(m_lfoDepths[ b ]) * 5.0f;
+        if ( envelopeToLfo ) { m_targets.lfoDepth[ b ] *= 1.0f - envelopeAmount + envelopeAmount * m_bandDynamics.getLevel( b ); }
+        m_targets.gain[ b ] = m_polarites[ b ] ? m_bandGains[ b ] * -1.0f : m_bandGains[ b ];
+
         // a little bit of scaling just to keep delay reasonable
-        for ( int c = 0; c < 2; c++ )
+        m_targets.delayTime[ b ] = 1.0f + m_delayTimes[ b ] * maxDelaySamples;
+        m_targets.delayTime[ b ] /= (float)( m_bandTickMasks[ b ] + 1 ); // delays on decimated bands run at the band's rate
+        m_targets.delayModScale[ b ] = 1.0f / (float)( m_bandTickMasks[ b ] + 1 );
+        m_delayLfos.setRate( b, delayModRate * getDelayLfoRateRatio( b ), getSampleRate() );
+        m_targets.feedback[ b ] = m_feedbacks[ b ] * 0.999f;
+        m_targets.delayWet[ b ] = std::sqrt( m_delayMix[ b ] );
+        m_targets.delayDry[ b ] = std::sqrt( 1.0f - m_delayMix[ b ] );
+
+        m_targets.lfoOn[ b ] = m_lfosOnOff[ b ];
+        // bands that have just been switched on wait until the message thread has given them some memory
+        m_targets.delayOn[ b ] = m_delaysOnOff[ b ] && m_delays[ b ].hasBuffers();
+
+        // only actually clears on the first block after the delay is switched off
+        if ( !m_targets.delayOn[ b ] ) { m_delays[ b ].clear(); }
+    }
+    // the governor's cheaper profiles cap the order, switching resets the filters so there's a small glitch at each step
+    auto filterOrder = (int)*filterOrderParameter;
+    if ( m_qualityLevel >= sjf_qualityGovernor::minimal ) { filterOrder = std::min( filterOrder, 2 ); }
+    else if ( m_qualityLevel >= sjf_qualityGovernor::reducedOrder ) { filterOrder = std::min( filterOrder, 4 ); }
+    selectFilters( (int)*filterDesignParameter, filterOrder );
+
+    auto tailLength = calculateTailLengthSeconds();
+    m_tailLengthSeconds.store( tailLength );
+    m_silenceDetector.setTailLengthSeconds( tailLength );
+
+    int whichBands = *bandsParameter;
+    m_targets.bandStart = (whichBands == 3) ? 1 : 0;
+    m_targets.bandIncrement = (whichBands == 1) ? 1 : 2;
+    const bool everyBandHeard = m_hasAuxOutputs || ( !m_multirateActive && (int)*feedbackMatrixParameter != sjf_feedbackMatrix< NUM_BANDS >::independent );
+    for ( int b = 0; b < NUM_BANDS; b++ ) { m_targets.bandHeard[ b ] = everyBandHeard || ( b >= m_targets.bandStart && ( b - m_targets.bandStart ) % m_targets.bandIncrement == 0 ); }
+}
+//==============================================================================
+std::array< float, 4 > Sjf_spectralProcessorAudioProcessor::calculateCorners( const float x, const float y )
+{
+    std::array< float, 4 > corners;
+    corners[0] = std::sqrt( std::pow(x, 2) + std::pow(y, 2) );
+    corners[1] = std::sqrt( std::pow(1.0f - x, 2) + std::pow(y, 2) );
+    corners[2] = std::sqrt( std::pow(1.0f - x, 2) + std::pow(1.0f - y, 2) );
+    corners[3] = std::sqrt( std::pow(x, 2) + std::pow(1.0f - y, 2) );
+    for ( int i = 0; i < corners.size(); i++ )
+    {
+        corners[i] = std::fmax( 0, 1.0f - corners[i] );
+    }
+    return corners;
+}
+//==============================================================================
+float Sjf_spectralProcessorAudioProcessor::getPadPosition( const int axis ) const
+{
+    // a position set over midi counts until the message thread has passed it on to the parameter
+    auto midiPosition = m_midiXY[ axis ].load();
+    return midiPosition >= 0.0f ? midiPosition : axis == 0 ? xParameter->load() : yParameter->load();
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::interpolateXY()
+{
+    m_interpolatedXY = { getPadPosition( 0 ), getPadPosition( 1 ) };
+    markParametersChanged( interpolatePresets( calculateCorners( m_interpolatedXY[ 0 ], m_interpolatedXY[ 1 ] ), &Sjf_spectralProcessorAudioProcessor::writeBandValue ) );
+}
+//==============================================================================
+bool Sjf_spectralProcessorAudioProcessor::handleMidiEvent( const juce::uint8* data, const int numBytes )
+{
+    // read straight from the raw bytes so nothing is copied or allocated, any channel is accepted
+    if ( numBytes < 2 ) { return false; }
+    const int status = data[ 0 ] & 0xf0;
+    if ( status == 0xc0 )
+    {
+        // program change recalls one of the presets straight into the band settings so it lands on its sample,
+        // the editor picks it up from m_midiPreset to show the preset and move the pad
+        if ( data[ 1 ] >= m_bandGainsPresets.size() ) { return false; }
+        markParametersChanged( recallPreset( data[ 1 ], &Sjf_spectralProcessorAudioProcessor::writeBandValue ) );
+        m_midiPreset = data[ 1 ];
+        return true;
+    }
+    if ( numBytes < 3 ) { return false; }
+    const float value = data[ 2 ] / 127.0f;
+    if ( status == 0xb0 )
+    {
+        const int cc = data[ 1 ];
+        if ( cc == MIDI_X_CC || cc == MIDI_Y_CC )
         {
-            delayTimeTarget[ b ] = 1.0f + 0.1f * m_delayTimes[ b ] * getSampleRate();
-            delayTimeTarget[ b ] += delayTimeTarget[ b ] * sjf_scale<float>( rand01(), 0.0f, 1.0f, -0.2, 0.2 ); // random fluctuations to add a little bit of spice
+            // the presets are interpolated straight away so the move lands on its sample,
+            // the parameter follows when the timer next finds it waiting, so the host and the editor agree with it
+            m_midiXY[ cc == MIDI_X_CC ? 0 : 1 ] = value;
+            interpolateXY();
+            return true;
         }
-        feedbackTarget[ b ] = m_feedbacks[ b ] * 0.999f;
-        
-        polarityFlip[ b ] = m_polarites[ b ];
-        
-        lfoOn[ b ] = m_lfosOnOff[ b ];
-        delayOn[ b ] = m_delaysOnOff[ b ];
-        
-        if ( !delayOn[ b ] )
+        if ( cc >= MIDI_FIRST_BAND_GAIN_CC && cc < MIDI_FIRST_BAND_GAIN_CC + NUM_BANDS )
         {
-            for ( int c = 0; c < m_delayLines.size(); c++ )
-            {
-                m_delayLines[ c ][ b ].clearDelayline();
-            }
+            m_bandGains[ cc - MIDI_FIRST_BAND_GAIN_CC ] = value;
+            markParametersChanged( bandGainGroup );
+            return true;
         }
+        return false;
     }
-    setFilterDesign( *filterDesignParameter );
-    setFilterOrder( *filterOrderParameter );
-//    polarityParameter
-    std::array< float, NUM_BANDS > filteredAudio, lfoOutputs, delayed, feedback, delayWetMix, delayDryMix, delayDryMixSmoothed, delayWetMixSmoothed,  bandGains;
+    if ( status == 0x90 && data[ 2 ] > 0 )
+    {
+        // note on sets the band's gain to the velocity, note off leaves it where it is
+        const int band = data[ 1 ] - MIDI_FIRST_BAND_NOTE;
+        if ( band < 0 || band >= NUM_BANDS ) { return false; }
+        m_bandGains[ band ] = value;
+        markParametersChanged( bandGainGroup );
+        return true;
+    }
+    return false;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::applyMidiParameterChanges()
+{
+    for ( int axis = 0; axis < 2; axis++ )
+    {
+        auto position = m_midiXY[ axis ].load();
+        if ( position < 0.0f ) { continue; }
+        // wrapped in a gesture so hosts record it like a move of the pad
+        xyParameters[ axis ]->beginChangeGesture();
+        xyParameters[ axis ]->setValueNotifyingHost( position );
+        xyParameters[ axis ]->endChangeGesture();
+        // only once the parameter holds it, a newer position that arrived in the meantime waits for the next update
+        m_midiXY[ axis ].compare_exchange_strong( position, -1.0f );
+    }
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::processSubBlock( juce::AudioBuffer< float >& buffer, const int startSample, const int numSamples, const int numChannels, const int numInputChannels )
+{
+    const bool analyse = m_analyserFifo.isEnabled();
+    if ( analyse ) { m_analyserFifo.captureInput( buffer, numInputChannels, startSample, numSamples ); }
     
-    for ( int b = 0; b < NUM_BANDS; b++ )
+#if SJF_SPECTRAL_METRICS
+    auto ticks = juce::Time::getHighResolutionTicks();
+    auto nextStage = [ this, &ticks ]( int stage )
+    {
+        if ( !m_collectMetrics ) { return; }
+        auto now = juce::Time::getHighResolutionTicks();
+        m_metrics.stageSeconds[ stage ] += juce::Time::highResolutionTicksToSeconds( now - ticks );
+        ticks = now;
+    };
+#else
+    auto nextStage = []( int ){};
+#endif
+
+    updateStaticChain();
+    const bool runChain = !m_staticInput || m_chainTailSamples > 0;
+    const bool runKernel = m_staticInput || m_staticTailSamples > 0;
+    if ( runChain )
+    {
+        ( this->*m_controlProcessor )( numSamples );
+        if ( !m_staticInput )
+        {
+            m_gainsSettled = true;
+            const float* lastFrame = m_gainFrames.data() + ( numSamples - 1 ) * NUM_BANDS;
+            for ( int b = 0; b < NUM_BANDS; b++ ) { m_gainsSettled &= std::abs( lastFrame[ b ] - m_targets.gain[ b ] ) < 0.000001f; }
+        }
+    }
+    nextStage( blockMetrics::control );
+
+    // the second channel is copied from the first at the end
+    const bool dualMono = updateDualMono( buffer, startSample, numSamples, numChannels, numInputChannels, runChain );
+    const int numChains = dualMono ? 1 : numChannels;
+    if ( runKernel )
     {
-        delayWetMix[ b ] = std::sqrt( m_delayMix[ b ] );
-        delayDryMix[ b ] = std::sqrt( 1.0f - m_delayMix[ b ] );
+        // read before the chain writes its output over the input. Every channel runs even while they are linked,
+        // so the kernel never has any state to catch up on
+        std::array< float*, 2 > frames;
+        for ( int channel = 0; channel < numChannels; channel++ )
+        {
+            frames[ channel ] = m_staticFrames[ channel ].data();
+            if ( m_staticInput ) { std::copy_n( buffer.getReadPointer( fastMod( channel, numInputChannels ), startSample ), numSamples, frames[ channel ] ); }
+            else { std::fill( frames[ channel ], frames[ channel ] + numSamples, 0.0f ); }
+        }
+        juce::dsp::AudioBlock< float > block( frames.data(), (size_t)numChannels, (size_t)numSamples );
+        m_staticKernel->convolution->process( juce::dsp::ProcessContextReplacing< float >( block ) );
+    }
+    nextStage( blockMetrics::filters );
+
+    if ( runChain )
+    {
+        for ( int channel = 0; channel < numChains; channel++ )
+        {
+            // while the kernel has the input the bands are left to ring out on silence
+            auto input = m_staticInput ? m_silence.data() : buffer.getReadPointer( fastMod( channel, numInputChannels ), startSample );
+            if ( m_multirateActive ) { filterBandsMultirate( input, channel, numSamples ); }
+            else { filterBands( input, channel, numSamples ); }
+        }
+        if ( m_vocoderActive ) { processVocoder( buffer, startSample, numChains, numSamples ); }
+        nextStage( blockMetrics::filters );
+
+        processDynamics( numChains, numSamples );
+        nextStage( blockMetrics::dynamics );
+
+        const int interpolation = m_renderQuality ? sjf_bandDelay< 2 >::lagrange : m_qualityLevel >= sjf_qualityGovernor::minimal ? sjf_bandDelay< 2 >::linear : (int)*delayInterpolationParameter;
+        ( this->*getDelayProcessor( interpolation, m_delayStorage ) )( numChains, numSamples );
+        nextStage( blockMetrics::delays );
     }
+
+    for ( int channel = 0; channel < numChains; channel++ )
+    {
+        auto output = buffer.getWritePointer( channel, startSample );
+        if ( !runChain ) { std::copy( m_staticFrames[ channel ].data(), m_staticFrames[ channel ].data() + numSamples, output ); continue; }
+        if ( m_multirateActive ) { reconstructBands( output, channel, numSamples ); }
+        else { ( this->*m_sumProcessor )( output, channel, numSamples ); }
+        if ( runKernel ) { juce::FloatVectorOperations::add( output, m_staticFrames[ channel ].data(), numSamples ); }
+    }
+    if ( dualMono ) { buffer.copyFrom( 1, startSample, buffer, 0, startSample, numSamples ); }
+    // multirate is held off while the aux buses are enabled, so the bands are always at the host rate here
+    if ( runChain && m_hasAuxOutputs ) { writeAuxOutputs( buffer, startSample, numSamples, numChains ); }
+    nextStage( blockMetrics::output );
+    if ( m_staticInput ) { m_chainTailSamples = std::max( m_chainTailSamples - numSamples, 0 ); }
+    else { m_staticTailSamples = std::max( m_staticTailSamples - numSamples, 0 ); }
     
-    float sampIn, sampOut, gain, lfoOut;
+    if ( analyse ) { m_analyserFifo.pushOutput( buffer, numChannels, startSample, numSamples ); }
+
+#if SJF_SPECTRAL_METRICS
+    // there are no bands to measure while the kernel has replaced them
+    if ( m_collectMetrics && runChain )
+    {
+        m_measuredSamples += numSamples * numChains;
+        for ( int channel = 0; channel < numChains; channel++ )
+        {
+            const float* frames = m_bandFrames[ channel ].data();
+            for ( int i = 0; i < numSamples * NUM_BANDS; i++ )
+            {
+                auto b = i % NUM_BANDS;
+                // decimated bands are zero between ticks
+                m_metrics.bandRms[ b ] += frames[ i ] * frames[ i ] * ( m_bandTickMasks[ b ] + 1 );
+                m_metrics.bandPeak[ b ] = std::fmax( m_metrics.bandPeak[ b ], std::abs( frames[ i ] ) );
+            }
+        }
+    }
+#endif
     
-    int whichBands = *bandsParameter;
-    int bandStart = (whichBands == 3) ? 1 : 0;
-    int bandIncrement = (whichBands == 1) ? 1 : 2;
-    for ( int indexThroughBuffer = 0; indexThroughBuffer < bufferSize; indexThroughBuffer++ )
+    m_hostSampleCount = ( m_hostSampleCount + numSamples ) & ( ( 1 << MAX_MULTIRATE_LEVELS ) - 1 );
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::calculateControlFrames( const int numSamples )
+{
+    float lfoOut;
+    for ( int indexThroughBuffer = 0; indexThroughBuffer < numSamples; indexThroughBuffer++ )
     {
-        for ( int b = 0; b < NUM_BANDS; b++ )
+        if ( --m_samplesUntilJitter < 0 )
+        {
+            // random fluctuations to add a little bit of spice
+            for ( auto& jitter : m_delayJitter ) { jitter = 1.0f + sjf_scale<float>( m_random.nextFloat(), 0.0f, 1.0f, -0.2, 0.2 ); }
+            m_samplesUntilJitter = JITTER_INTERVAL - 1;
+        }
+        auto frame = indexThroughBuffer * NUM_BANDS;
+        // one phase per band shared by both channels, the second channel is offset by the spread.
+        // Adds between 0 and the depth to the delay time so it never has to go below the slider's setting
+        m_delayLfos.advance();
+        auto* phases = m_delayLfos.getPhases();
+        auto depth = 0.5f * m_delayModDepthSmoother.filterInput( m_targets.delayModDepth );
+        auto spread = m_delayModSpreadSmoother.filterInput( m_targets.delayModSpread );
+        auto modulate = [ & ]( auto sine )
         {
-            lfoOut = fFold<float > ( m_lfos[ b ].output() * lfoDepths[ b ], -2.0f, 2.0f );
-            lfoOutputs[ b ] = m_lfoSmoother[ b ].filterInput( lfoOut );
             for ( int channel = 0; channel < 2; channel++ )
             {
-                m_delayLines[ channel ][ b ].setDelayTimeSamps( m_delaySmoother[ b ].filterInput( delayTimeTarget[ b ] ) );
+                auto offset = channel * spread;
+                float* mod = m_delayModFrames[ channel ].data() + frame;
+                for ( int b = 0; b < NUM_BANDS; b++ ) { mod[ b ] = depth * m_targets.delayModScale[ b ] * ( 1.0f + sine( phases[ b ] + offset ) ); }
             }
-            feedback[ b ] = m_fbSmoother[ b ].filterInput( feedbackTarget[ b ] );
-            delayWetMixSmoothed[ b ] = m_delayWetSmoother[ b ].filterInput( delayWetMix[ b ] );
-            delayDryMixSmoothed[ b ] = m_delayDrySmoother[ b ].filterInput( delayDryMix[ b ] );
-            gain = polarityFlip[ b ] ? bandGainTargets[ b ] * -1.0f : bandGainTargets[ b ];
-            bandGains[ b ] = m_gainSmoother[ b ].filterInput( gain );
+        };
+        if ( m_renderQuality ) { modulate( []( float phase ) { return std::sin( juce::MathConstants< float >::twoPi * phase ); } ); }
+        else { modulate( []( float phase ) { return sjf_phasorBank< NUM_BANDS >::sine( phase ); } ); }
+        for ( int b = 0; b < NUM_BANDS; b++ )
+        {
+            lfoOut = fFold<float > ( m_lfos[ b ].output() * m_targets.lfoDepth[ b ], -2.0f, 2.0f );
+            lfoOut = m_lfoSmoother[ b ].filterInput( lfoOut );
+            m_delayTimeFrames[ frame + b ] = m_delaySmoother[ b ].filterInput( m_targets.delayTime[ b ] * m_delayJitter[ b ] );
+            m_feedbackFrames[ frame + b ] = m_fbSmoother[ b ].filterInput( m_targets.feedback[ b ] );
+            m_delayWetFrames[ frame + b ] = m_delayWetSmoother[ b ].filterInput( m_targets.delayWet[ b ] );
+            m_delayDryFrames[ frame + b ] = m_delayDrySmoother[ b ].filterInput( m_targets.delayDry[ b ] );
+            auto gain = m_gainSmoother[ b ].filterInput( m_targets.gain[ b ] );
+            if ( m_targets.lfoOn[ b ] ) { gain += gain * lfoOut; }
+            m_gainFrames[ frame + b ] = gain;
         }
-        // do lfo and weirdness here
-        for ( int channel = 0; channel < totalNumOutputChannels; channel++ )
+    }
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::filterBands( const float* input, const int channel, const int numSamples )
+{
+    // one band at a time so each cascade stays in cache for the whole block
+    float* frames = m_bandFrames[ channel ].data();
+    for ( int b = 0; b < NUM_BANDS; b++ )
+    {
+        if ( canSkipBand( b ) )
+        {
+            for ( int i = 0; i < numSamples; i++ ) { frames[ i * NUM_BANDS + b ] = 0.0f; }
+            m_filters[ channel ][ b ] = m_bandDesigns[ b ];
+            continue;
+        }
+        m_filterKernel( input, 1, m_gainFrames.data() + b, frames + b, NUM_BANDS, numSamples, m_filters[ channel ][ b ] );
+    }
+}
+//==============================================================================
+bool Sjf_spectralProcessorAudioProcessor::canSkipBand( const int band ) const
+{
+    if ( m_qualityLevel < sjf_qualityGovernor::skipInactiveBands ) { return false; }
+    if ( !m_targets.bandHeard[ band ] ) { return true; }
+    // the gain smoother only heads towards its target, so once it has got to ( almost ) zero it stays there for the block
+    return m_targets.gain[ band ] == 0.0f && std::abs( m_gainFrames[ band ] ) < 0.00001f;
+}
+//==============================================================================
+bool Sjf_spectralProcessorAudioProcessor::chainIsStatic() const
+{
+    using dynamics = sjf_bandDynamics< NUM_BANDS >;
+    // the aux buses need the bands themselves, and multirate bands aren't at the rate the kernel is built for.
+    // Offline renders keep the bands so they don't depend on when the message thread gets round to building the kernel
+    if ( m_renderQuality || m_multirateActive || m_hasAuxOutputs || m_vocoderActive ) { return false; }
+    if ( (int)*dynamicsModeParameter != dynamics::off || (int)*envelopeTargetParameter != dynamics::noTarget ) { return false; }
+    for ( int b = 0; b < NUM_BANDS; b++ )
+    {
+        if ( m_targets.lfoOn[ b ] || m_targets.delayOn[ b ] ) { return false; }
+    }
+    return true;
+}
+//==============================================================================
+Sjf_spectralProcessorAudioProcessor::staticSpec Sjf_spectralProcessorAudioProcessor::getStaticSpec() const
+{
+    // bands that aren't routed to the output are left out of the kernel
+    staticSpec spec;
+    for ( int b = m_targets.bandStart; b < NUM_BANDS; b += m_targets.bandIncrement ) { spec.gains[ b ] = m_targets.gain[ b ]; }
+    spec.filterDesign = m_filterDesign;
+    spec.filterOrder = m_filterOrder;
+    return spec;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::updateStaticChain()
+{
+    if ( m_staticInput )
+    {
+        if ( chainIsStatic() && m_staticKernel->spec == getStaticSpec() ) { return; }
+        // back to the bands. If they have finished ringing out their state is stale, so they start again from silence
+        if ( m_chainTailSamples == 0 ) { resetChain(); }
+        m_staticInput = false;
+        m_chainTailSamples = 0;
+        m_staticTailSamples = m_staticKernel->length;
+        return;
+    }
+    // the kernel is built from the targets, so the smoothers have to have got there first
+    if ( m_staticTailSamples > 0 || !m_gainsSettled || !chainIsStatic() ) { return; }
+    auto spec = getStaticSpec();
+    if ( m_staticKernel != nullptr && m_staticKernel->spec == spec )
+    {
+        // measured as slower than the bands, so they carry on
+        if ( m_staticKernel->convolution == nullptr ) { return; }
+        m_staticKernel->convolution->reset();
+        m_staticInput = true;
+        m_chainTailSamples = m_staticKernel->length;
+        return;
+    }
+    if ( m_staticRequested && m_staticRequest == spec ) { return; }
+    m_staticRequest = spec;
+    m_staticRequested = true;
+    m_staticKernelRequested = true;
+}
+//==============================================================================
+bool Sjf_spectralProcessorAudioProcessor::updateDualMono( const juce::AudioBuffer< float >& buffer, const int startSample, const int numSamples, const int numChannels, const int numInputChannels, const bool checkModulation )
+{
+    if ( numChannels < 2 ) { return false; }
+    // a mono input is read for both channels
+    bool identical = numInputChannels < 2 || std::memcmp( buffer.getReadPointer( 0, startSample ), buffer.getReadPointer( 1, startSample ), sizeof( float ) * (size_t)numSamples ) == 0;
+    // the delay modulation is the only control that can differ between the channels
+    if ( identical && checkModulation && std::any_of( m_targets.delayOn.begin(), m_targets.delayOn.end(), []( bool on ) { return on; } ) )
+    {
+        identical = std::memcmp( m_delayModFrames[ 0 ].data(), m_delayModFrames[ 1 ].data(), sizeof( float ) * (size_t)( numSamples * NUM_BANDS ) ) == 0;
+    }
+    if ( !identical )
+    {
+        if ( m_channelsLinked ) { unlinkChannels(); }
+        m_identicalSamples = 0;
+        return false;
+    }
+    m_identicalSamples += numSamples;
+    if ( !m_channelsLinked ) { m_channelsLinked = m_identicalSamples >= (juce::int64)( m_tailLengthSeconds.load() * getSampleRate() ); }
+    return m_channelsLinked;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::unlinkChannels()
+{
+    // the delay lines have been mirrored all along
+    m_filters[ 1 ] = m_filters[ 0 ];
+    dcFilter[ 1 ] = dcFilter[ 0 ];
+    m_multirateTrees[ 1 ].copyStateFrom( m_multirateTrees[ 0 ] );
+    m_channelsLinked = false;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::resetChain()
+{
+    resetFilters();
+    for ( auto& filter : dcFilter ) { filter = sjf_lpf< float >(); }
+    initialiseDCBlock( getSampleRate() );
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::rebuildStaticKernel()
+{
+    staticSpec spec;
+    {
+        const juce::ScopedLock lock( getCallbackLock() );
+        if ( !m_staticRequested || m_preparedSampleRate <= 0.0 ) { return; }
+        spec = m_staticRequest;
+        spec.sampleRate = m_preparedSampleRate;
+        spec.blockSize = m_maxBlockSize;
+        spec.kernelLevel = m_kernelLevel;
+        spec.filters = m_filterTable;
+    }
+    // built without the lock, the audio thread only waits for the swap
+    auto kernel = std::make_unique< staticKernel >();
+    kernel->spec = spec;
+    auto impulse = calculateStaticImpulse( spec );
+    kernel->length = (int)impulse.size();
+    // zero latency, with the head partitioned at the block size and longer partitions behind it for the tail.
+    // Loading before prepare makes the impulse live straight away, rather than fading in from a background thread
+    kernel->convolution = std::make_unique< juce::dsp::Convolution >( juce::dsp::Convolution::NonUniform { juce::jlimit( 64, 4096, juce::nextPowerOfTwo( spec.blockSize ) ) } );
+    juce::AudioBuffer< float > impulseBuffer( 1, kernel->length );
+    impulseBuffer.copyFrom( 0, 0, impulse.data(), kernel->length );
+    kernel->convolution->loadImpulseResponse( std::move( impulseBuffer ), spec.sampleRate, juce::dsp::Convolution::Stereo::no, juce::dsp::Convolution::Trim::no, juce::dsp::Convolution::Normalise::no );
+    kernel->convolution->prepare( { spec.sampleRate, (juce::uint32)spec.blockSize, 2 } );
+    // a long kernel can cost more than the bands it replaces, the spec is then kept on the bands
+    if ( !staticKernelIsCheaper( *kernel->convolution, spec ) ) { kernel->convolution = nullptr; }
+    {
+        const juce::ScopedLock lock( getCallbackLock() );
+        // a newer request has its own update on the way, and one from before the last prepareToPlay is stale
+        if ( !m_staticRequested || !( m_staticRequest == spec ) || spec.sampleRate != m_preparedSampleRate || spec.blockSize != m_maxBlockSize ) { return; }
+        m_staticRequested = false;
+        // the old kernel can't be swapped out while it's running, the audio thread asks again once it has finished
+        if ( m_staticInput || m_staticTailSamples > 0 ) { return; }
+        std::swap( m_staticKernel, kernel );
+    }
+}
+//==============================================================================
+std::vector< float > Sjf_spectralProcessorAudioProcessor::calculateStaticImpulse( const staticSpec& spec )
+{
+    const auto maxLength = (size_t)( MAX_STATIC_KERNEL_SECONDS * spec.sampleRate );
+    std::vector< float > impulse( maxLength, 0.0f ), input( maxLength, 0.0f ), band( maxLength ), unity( maxLength, 1.0f );
+    input[ 0 ] = 1.0f;
+    // the same host rate filters and kernel as filterBands
+    auto* designs = spec.filters->data() + getFilterTableIndex( false, spec.filterDesign, spec.filterOrder );
+    auto kernel = sjf_cascadeKernels::get( spec.kernelLevel );
+    for ( int b = 0; b < NUM_BANDS; b++ )
+    {
+        if ( spec.gains[ b ] == 0.0f ) { continue; }
+        auto filter = designs[ b ];
+        kernel( input.data(), 1, unity.data(), band.data(), 1, (int)maxLength, filter );
+        for ( size_t i = 0; i < maxLength; i++ ) { impulse[ i ] += spec.gains[ b ] * band[ i ]; }
+    }
+    // and the same dc filter as sumBands
+    sjf_lpf< float > dc;
+    dc.setCutoff( calculateLPFCoefficient< float >( 15, spec.sampleRate ) );
+    for ( auto& x : impulse ) { x -= dc.filterInputSecondOrder( x ); }
+    // cut the tail once what's left is 100dB down
+    double total = 0.0, tail = 0.0;
+    for ( auto x : impulse ) { total += (double)x * x; }
+    auto length = maxLength;
+    while ( length > 1 && tail + (double)impulse[ length - 1 ] * impulse[ length - 1 ] < total * 1e-10 )
+    {
+        length--;
+        tail += (double)impulse[ length ] * impulse[ length ];
+    }
+    impulse.resize( length );
+    return impulse;
+}
+//==============================================================================
+bool Sjf_spectralProcessorAudioProcessor::staticKernelIsCheaper( juce::dsp::Convolution& convolution, const staticSpec& spec )
+{
+    // both run over the same noise for both channels in blocks of the prepared size, best of a few runs.
+    // The bands are timed through the filters, the sum and the dc filter, everything the kernel stands in for
+    // apart from the gain smoothing
+    static constexpr double benchmarkSeconds = 0.1;
+    static constexpr int numRuns = 3;
+    const int numBlocks = std::max( (int)( benchmarkSeconds * spec.sampleRate ) / spec.blockSize, 1 );
+    const auto frameSize = (size_t)( spec.blockSize * NUM_BANDS );
+    std::vector< float > noise( (size_t)spec.blockSize ), frames( frameSize ), unity( frameSize, 1.0f );
+    juce::Random random( 1 );
+    for ( auto& x : noise ) { x = random.nextFloat() * 2.0f - 1.0f; }
+    std::array< std::vector< float >, 2 > channels { noise, noise };
+    std::array< float*, 2 > channelPointers { channels[ 0 ].data(), channels[ 1 ].data() };
+    auto* designs = spec.filters->data() + getFilterTableIndex( false, spec.filterDesign, spec.filterOrder );
+    auto kernel = sjf_cascadeKernels::get( spec.kernelLevel );
+    std::array< std::array< sjf_bandFilter, NUM_BANDS >, 2 > filters;
+    for ( auto& channel : filters ) { std::copy( designs, designs + NUM_BANDS, channel.begin() ); }
+    std::array< sjf_lpf< float >, 2 > dcFilters;
+    for ( auto& dc : dcFilters ) { dc.setCutoff( calculateLPFCoefficient< float >( 15, spec.sampleRate ) ); }
+    std::vector< float > output( (size_t)spec.blockSize );
+
+    auto time = [ numBlocks ]( auto&& processBlock )
+    {
+        auto best = std::numeric_limits< double >::max();
+        for ( int run = 0; run < numRuns; run++ )
+        {
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            for ( int block = 0; block < numBlocks; block++ ) { processBlock(); }
+            best = std::min( best, juce::Time::highResolutionTicksToSeconds( juce::Time::getHighResolutionTicks() - startTicks ) );
+        }
+        return best;
+    };
+    auto chainSeconds = time( [ & ]()
+    {
+        for ( int c = 0; c < (int)filters.size(); c++ )
         {
-            sampIn = buffer.getSample( fastMod( channel, totalNumInputChannels ), indexThroughBuffer );
-            sampOut = 0;
             for ( int b = 0; b < NUM_BANDS; b++ )
             {
-                gain = bandGains[ b ];
-                if ( lfoOn[ b ] ) { gain += gain * lfoOutputs[ b ]; }
-                filteredAudio[ b ] = m_filters[ channel ][ b ].filterInput( sampIn );
-                filteredAudio[ b ] *=  gain;
-                if ( delayOn[ b ] )
-                {
-                    delayed[ b ] = m_delayLines[ channel ][ b ].getSample2();
-                    m_delayLines[ channel ][ b ].setSample2( filteredAudio[ b ] + delayed[ b ] * feedback[ b ]);
-                }
+                if ( spec.gains[ b ] != 0.0f ) { kernel( noise.data(), 1, unity.data() + b, frames.data() + b, NUM_BANDS, spec.blockSize, filters[ c ][ b ] ); }
             }
-            // only output odd/even/all bands
-            for ( int b = bandStart; b < NUM_BANDS; b += bandIncrement )
+            // the same sum and dc filter as sumBands
+            for ( int i = 0; i < spec.blockSize; i++ )
             {
-                if ( delayOn[ b ] )
-                {
-                    sampOut += ( delayed[ b ] * delayWetMixSmoothed[ b ] ) + ( filteredAudio[ b ] * delayDryMixSmoothed[ b ] );
-                }
-                else { sampOut += filteredAudio[ b ]; }
+                float sampOut = 0.0f;
+                for ( int b = 0; b < NUM_BANDS; b++ ) { if ( spec.gains[ b ] != 0.0f ) { sampOut += frames[ (size_t)( i * NUM_BANDS + b ) ]; } }
+                output[ (size_t)i ] = sampOut - dcFilters[ c ].filterInputSecondOrder( sampOut );
             }
-            sampOut -= dcFilter[ channel ].filterInputSecondOrder( sampOut );
-            buffer.setSample( channel, indexThroughBuffer, sampOut );
         }
+    } );
+    auto kernelSeconds = time( [ & ]()
+    {
+        for ( auto& channel : channels ) { std::copy( noise.begin(), noise.end(), channel.begin() ); }
+        juce::dsp::AudioBlock< float > block( channelPointers.data(), channelPointers.size(), (size_t)spec.blockSize );
+        convolution.process( juce::dsp::ProcessContextReplacing< float >( block ) );
+    } );
+    convolution.reset();
+    return kernelSeconds < chainSeconds;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::filterBandsMultirate( const float* input, const int channel, const int numSamples )
+{
+    static constexpr int levelStride = MAX_MULTIRATE_LEVELS + 1;
+    float* frames = m_bandFrames[ channel ].data();
+    float* levels = m_levelFrames[ channel ].data();
+    // each level only gets written on the samples it ticks
+    for ( int indexThroughBuffer = 0; indexThroughBuffer < numSamples; indexThroughBuffer++ )
+    {
+        m_multirateTrees[ channel ].analyse( input[ indexThroughBuffer ], m_hostSampleCount + indexThroughBuffer, levels + indexThroughBuffer * levelStride );
+    }
+    // bands are left at zero between their ticks
+    std::fill( frames, frames + numSamples * NUM_BANDS, 0.0f );
+    for ( int b = 0; b < NUM_BANDS; b++ )
+    {
+        auto step = m_bandTickMasks[ b ] + 1;
+        auto first = ( -m_hostSampleCount ) & m_bandTickMasks[ b ];
+        if ( first >= numSamples ) { continue; }
+        // frames are already zero, the state restarts when the band comes back
+        if ( canSkipBand( b ) ) { m_filters[ channel ][ b ] = m_bandDesigns[ b ]; continue; }
+        auto numTicks = ( numSamples - first + step - 1 ) / step;
+        m_filterKernel( levels + first * levelStride + m_bandLevels[ b ], levelStride * step, m_gainFrames.data() + first * NUM_BANDS + b, frames + first * NUM_BANDS + b, NUM_BANDS * step, numTicks, m_filters[ channel ][ b ] );
+    }
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::processVocoder( const juce::AudioBuffer< float >& buffer, const int startSample, const int numChannels, const int numSamples )
+{
+    // the sidechain goes through the same kernel and filter table as the main input, always at the host rate
+    const int numSidechainChannels = std::min( m_sidechainNumChannels, (int)m_sidechainFrames.size() );
+    for ( int channel = 0; channel < numSidechainChannels; channel++ )
+    {
+        auto input = buffer.getReadPointer( m_sidechainFirstChannel + channel, startSample );
+        float* frames = m_sidechainFrames[ channel ].data();
+        for ( int b = 0; b < NUM_BANDS; b++ )
+        {
+            m_filterKernel( input, 1, m_unityFrames.data() + b, frames + b, NUM_BANDS, numSamples, m_sidechainFilters[ channel ][ b ] );
+        }
+    }
+    float* left = m_sidechainFrames[ 0 ].data();
+    float* right = numSidechainChannels > 1 ? m_sidechainFrames[ 1 ].data() : left;
+    m_vocoderEnvelopes.process( left, right, numSamples, m_hostSampleCount, m_vocoderFrames.data() );
+    // decimated carrier bands are zero between ticks, so every band can be scaled on every sample
+    for ( int channel = 0; channel < numChannels; channel++ )
+    {
+        float* frames = m_bandFrames[ channel ].data();
+        for ( int i = 0; i < numSamples * NUM_BANDS; i++ ) { frames[ i ] *= m_vocoderFrames[ i ]; }
+    }
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::processDynamics( const int numChannels, const int numSamples )
+{
+    using dynamics = sjf_bandDynamics< NUM_BANDS >;
+    const int target = (int)*envelopeTargetParameter;
+    if ( (int)*dynamicsModeParameter == dynamics::off && target == dynamics::noTarget ) { return; }
+    const bool duckFeedback = target == dynamics::feedbackTarget;
+    float* left = m_bandFrames[ 0 ].data();
+    float* right = numChannels > 1 ? m_bandFrames[ 1 ].data() : left;
+    m_bandDynamics.process( left, right, numSamples, m_hostSampleCount, duckFeedback ? m_envelopeFrames.data() : nullptr );
+    if ( !duckFeedback ) { return; }
+    // the louder the band the less of it is fed back
+    const float amount = *envelopeAmountParameter;
+    for ( int i = 0; i < numSamples * NUM_BANDS; i++ ) { m_feedbackFrames[ i ] *= 1.0f - amount * m_envelopeFrames[ i ]; }
+}
+//==============================================================================
+Sjf_spectralProcessorAudioProcessor::delayProcessor Sjf_spectralProcessorAudioProcessor::getDelayProcessor( const int interpolation, const int storage )
+{
+    switch ( storage )
+    {
+        case float16Storage: return getDelayProcessor< sjf_float16Storage >( interpolation );
+        case bfloat16Storage: return getDelayProcessor< sjf_bfloat16Storage >( interpolation );
+        case int24Storage: return getDelayProcessor< sjf_int24Storage >( interpolation );
+        default: return getDelayProcessor< sjf_float32Storage >( interpolation );
+    }
+}
+//==============================================================================
+template< typename STORAGE >
+Sjf_spectralProcessorAudioProcessor::delayProcessor Sjf_spectralProcessorAudioProcessor::getDelayProcessor( const int interpolation )
+{
+    switch ( interpolation )
+    {
+        case sjf_bandDelay< 2 >::allpass: return getDelayProcessor< sjf_bandDelay< 2 >::allpass, STORAGE >();
+        case sjf_bandDelay< 2 >::cubic: return getDelayProcessor< sjf_bandDelay< 2 >::cubic, STORAGE >();
+        case sjf_bandDelay< 2 >::lagrange: return getDelayProcessor< sjf_bandDelay< 2 >::lagrange, STORAGE >();
+        default: return getDelayProcessor< sjf_bandDelay< 2 >::linear, STORAGE >();
+    }
+}
+//==============================================================================
+template< int INTERPOLATION, typename STORAGE >
+Sjf_spectralProcessorAudioProcessor::delayProcessor Sjf_spectralProcessorAudioProcessor::getDelayProcessor()
+{
+    switch ( m_kernelLevel )
+    {
+#if SJF_X86_DISPATCH
+        case sjf_cpuDispatch::avx512: return &Sjf_spectralProcessorAudioProcessor::processDelaysAVX512< INTERPOLATION, STORAGE >;
+        case sjf_cpuDispatch::avx2: return &Sjf_spectralProcessorAudioProcessor::processDelaysAVX2< INTERPOLATION, STORAGE >;
+#endif
+        default: return &Sjf_spectralProcessorAudioProcessor::processDelaysBaseline< INTERPOLATION, STORAGE >;
+    }
+}
+//==============================================================================
+template< int INTERPOLATION, typename STORAGE >
+void Sjf_spectralProcessorAudioProcessor::processDelays( const int numChannels, const int numSamples )
+{
+    // in multirate the bands tick at different rates, so there's no single sample to mix them on
+    const int matrixType = m_multirateActive ? sjf_feedbackMatrix< NUM_BANDS >::independent : (int)*feedbackMatrixParameter;
+    if ( matrixType != sjf_feedbackMatrix< NUM_BANDS >::independent ) { return processDelaysMixed< INTERPOLATION, STORAGE >( numChannels, numSamples, matrixType ); }
+    float delayed;
+    for ( int indexThroughBuffer = 0; indexThroughBuffer < numSamples; indexThroughBuffer++ )
+    {
+        auto frame = indexThroughBuffer * NUM_BANDS;
+        for ( int b = 0; b < NUM_BANDS; b++ )
+        {
+            if ( !m_targets.delayOn[ b ] || ( ( m_hostSampleCount + indexThroughBuffer ) & m_bandTickMasks[ b ] ) ) { continue; }
+            auto& delay = m_delays[ b ];
+            for ( int channel = 0; channel < numChannels; channel++ )
+            {
+                // the channels only differ by their delay modulation
+                delay.template setDelayTimeSamps< INTERPOLATION >( channel, m_delayTimeFrames[ frame + b ] + m_delayModFrames[ channel ][ frame + b ] );
+                float& band = m_bandFrames[ channel ][ frame + b ];
+                delayed = delay.template read< INTERPOLATION, STORAGE >( channel );
+                auto feedback = delayed * m_feedbackFrames[ frame + b ];
+                delay.template write< STORAGE >( channel, band + feedback );
+                band = ( delayed * m_delayWetFrames[ frame + b ] ) + ( band * m_delayDryFrames[ frame + b ] );
+#if SJF_SPECTRAL_METRICS
+                if ( m_collectMetrics ) { m_metrics.feedbackEnergy[ b ] += feedback * feedback * ( m_bandTickMasks[ b ] + 1 ); }
+#endif
+            }
+            if ( m_channelsLinked ) { delay.template mirrorFirstChannel< STORAGE >(); }
+            delay.advance();
+        }
+    }
+}
+//==============================================================================
+template< int INTERPOLATION, typename STORAGE >
+void Sjf_spectralProcessorAudioProcessor::processDelaysMixed( const int numChannels, const int numSamples, const int matrixType )
+{
+    // every band's delay is read before any is written so the feedback can be mixed across bands,
+    // bands with their delay off neither send nor receive feedback
+    std::array< std::array< float, NUM_BANDS >, 2 > delayed, feedback;
+    for ( int indexThroughBuffer = 0; indexThroughBuffer < numSamples; indexThroughBuffer++ )
+    {
+        auto frame = indexThroughBuffer * NUM_BANDS;
+        for ( int channel = 0; channel < numChannels; channel++ ) { feedback[ channel ].fill( 0.0f ); }
+        for ( int b = 0; b < NUM_BANDS; b++ )
+        {
+            if ( !m_targets.delayOn[ b ] ) { continue; }
+            auto& delay = m_delays[ b ];
+            for ( int channel = 0; channel < numChannels; channel++ )
+            {
+                delay.template setDelayTimeSamps< INTERPOLATION >( channel, m_delayTimeFrames[ frame + b ] + m_delayModFrames[ channel ][ frame + b ] );
+                delayed[ channel ][ b ] = delay.template read< INTERPOLATION, STORAGE >( channel );
+                feedback[ channel ][ b ] = delayed[ channel ][ b ] * m_feedbackFrames[ frame + b ];
+            }
+        }
+        for ( int channel = 0; channel < numChannels; channel++ ) { m_feedbackMatrix.process( feedback[ channel ].data(), matrixType ); }
+        for ( int b = 0; b < NUM_BANDS; b++ )
+        {
+            if ( !m_targets.delayOn[ b ] ) { continue; }
+            auto& delay = m_delays[ b ];
+            for ( int channel = 0; channel < numChannels; channel++ )
+            {
+                float& band = m_bandFrames[ channel ][ frame + b ];
+                delay.template write< STORAGE >( channel, band + feedback[ channel ][ b ] );
+                band = ( delayed[ channel ][ b ] * m_delayWetFrames[ frame + b ] ) + ( band * m_delayDryFrames[ frame + b ] );
+#if SJF_SPECTRAL_METRICS
+                if ( m_collectMetrics ) { m_metrics.feedbackEnergy[ b ] += feedback[ channel ][ b ] * feedback[ channel ][ b ]; }
+#endif
+            }
+            if ( m_channelsLinked ) { delay.template mirrorFirstChannel< STORAGE >(); }
+            delay.advance();
+        }
+    }
+}
+//==============================================================================
+bool Sjf_spectralProcessorAudioProcessor::setCustomFeedbackMatrix( const std::array< float, NUM_BANDS * NUM_BANDS >& matrix )
+{
+    // the gain is measured and limited before taking the lock, the audio thread only waits for the copy
+    sjf_feedbackMatrix< NUM_BANDS > limited;
+    if ( !limited.setCustom( matrix ) ) { return false; }
+    const juce::ScopedLock lock( getCallbackLock() );
+    m_feedbackMatrix = limited;
+    return true;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::sumBands( float* output, const int channel, const int numSamples )
+{
+    const float* frames = m_bandFrames[ channel ].data();
+    float sampOut;
+    for ( int indexThroughBuffer = 0; indexThroughBuffer < numSamples; indexThroughBuffer++ )
+    {
+        auto frame = indexThroughBuffer * NUM_BANDS;
+        sampOut = 0;
+        // only output odd/even/all bands
+        for ( int b = m_targets.bandStart; b < NUM_BANDS; b += m_targets.bandIncrement )
+        {
+            sampOut += frames[ frame + b ];
+        }
+        sampOut -= dcFilter[ channel ].filterInputSecondOrder( sampOut );
+        output[ indexThroughBuffer ] = sampOut;
+    }
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::reconstructBands( float* output, const int channel, const int numSamples )
+{
+    const float* frames = m_bandFrames[ channel ].data();
+    std::array< float, MAX_MULTIRATE_LEVELS + 1 > levelSums;
+    float sampOut;
+    for ( int indexThroughBuffer = 0; indexThroughBuffer < numSamples; indexThroughBuffer++ )
+    {
+        auto frame = indexThroughBuffer * NUM_BANDS;
+        levelSums.fill( 0.0f );
+        // bands that didn't tick on this sample are zero, so they can be summed regardless
+        for ( int b = m_targets.bandStart; b < NUM_BANDS; b += m_targets.bandIncrement )
+        {
+            levelSums[ m_bandLevels[ b ] ] += frames[ frame + b ];
+        }
+        sampOut = m_multirateTrees[ channel ].synthesise( levelSums.data(), m_hostSampleCount + indexThroughBuffer );
+        sampOut -= dcFilter[ channel ].filterInputSecondOrder( sampOut );
+        output[ indexThroughBuffer ] = sampOut;
+    }
+}
+//==============================================================================
+// each wrapper only inlines the stage into a function compiled for its own instruction set
+void Sjf_spectralProcessorAudioProcessor::calculateControlFramesBaseline( const int numSamples ) { calculateControlFrames( numSamples ); }
+template< int INTERPOLATION, typename STORAGE >
+void Sjf_spectralProcessorAudioProcessor::processDelaysBaseline( const int numChannels, const int numSamples ) { processDelays< INTERPOLATION, STORAGE >( numChannels, numSamples ); }
+void Sjf_spectralProcessorAudioProcessor::sumBandsBaseline( float* output, const int channel, const int numSamples ) { sumBands( output, channel, numSamples ); }
+#if SJF_X86_DISPATCH
+SJF_TARGET_AVX2 void Sjf_spectralProcessorAudioProcessor::calculateControlFramesAVX2( const int numSamples ) { calculateControlFrames( numSamples ); }
+template< int INTERPOLATION, typename STORAGE >
+SJF_TARGET_AVX2 void Sjf_spectralProcessorAudioProcessor::processDelaysAVX2( const int numChannels, const int numSamples ) { processDelays< INTERPOLATION, STORAGE >( numChannels, numSamples ); }
+SJF_TARGET_AVX2 void Sjf_spectralProcessorAudioProcessor::sumBandsAVX2( float* output, const int channel, const int numSamples ) { sumBands( output, channel, numSamples ); }
+SJF_TARGET_AVX512 void Sjf_spectralProcessorAudioProcessor::calculateControlFramesAVX512( const int numSamples ) { calculateControlFrames( numSamples ); }
+template< int INTERPOLATION, typename STORAGE >
+SJF_TARGET_AVX512 void Sjf_spectralProcessorAudioProcessor::processDelaysAVX512( const int numChannels, const int numSamples ) { processDelays< INTERPOLATION, STORAGE >( numChannels, numSamples ); }
+SJF_TARGET_AVX512 void Sjf_spectralProcessorAudioProcessor::sumBandsAVX512( float* output, const int channel, const int numSamples ) { sumBands( output, channel, numSamples ); }
+#endif
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::writeAuxOutputs( juce::AudioBuffer< float >& buffer, const int startSample, const int numSamples, const int numChannels )
+{
+    // aux channels can share the buffer with the sidechain, which has been read by now. Several bands can share a bus
+    for ( auto& aux : m_auxOutputs )
+    {
+        for ( int c = 0; c < aux.numChannels; c++ ) { buffer.clear( aux.firstChannel + c, startSample, numSamples ); }
+    }
+    const int routing = (int)*auxRoutingParameter;
+    for ( int b = 0; b < NUM_BANDS; b++ )
+    {
+        auto& aux = m_auxOutputs[ getAuxBus( routing, b ) ];
+        for ( int c = 0; c < aux.numChannels; c++ )
+        {
+            const float* frames = m_bandFrames[ std::min( c, numChannels - 1 ) ].data();
+            auto output = buffer.getWritePointer( aux.firstChannel + c, startSample );
+            for ( int indexThroughBuffer = 0; indexThroughBuffer < numSamples; indexThroughBuffer++ ) { output[ indexThroughBuffer ] += frames[ indexThroughBuffer * NUM_BANDS + b ]; }
+        }
+    }
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::updateAuxOutputs()
+{
+    bool hasAuxOutputs = false;
+    for ( int b = 0; b < NUM_BANDS; b++ )
+    {
+        auto* bus = getBus( false, b + 1 );
+        auto& aux = m_auxOutputs[ b ];
+        aux.numChannels = bus != nullptr && bus->isEnabled() ? std::min( bus->getNumberOfChannels(), 2 ) : 0;
+        aux.firstChannel = aux.numChannels > 0 ? bus->getChannelIndexInProcessBlockBuffer( 0 ) : 0;
+        hasAuxOutputs = hasAuxOutputs || aux.numChannels > 0;
+    }
+    m_hasAuxOutputs = hasAuxOutputs;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::updateSidechain()
+{
+    auto* bus = getBus( true, 1 );
+    m_sidechainNumChannels = bus != nullptr && bus->isEnabled() ? bus->getNumberOfChannels() : 0;
+    m_sidechainFirstChannel = m_sidechainNumChannels > 0 ? bus->getChannelIndexInProcessBlockBuffer( 0 ) : 0;
+}
+//==============================================================================
+int Sjf_spectralProcessorAudioProcessor::getAuxBus( const int routing, const int band )
+{
+    // values match the "auxRouting" parameter
+    switch ( routing )
+    {
+        case 2: return band / 2; // pairs of neighbouring bands
+        case 3: return band / 4; // groups of four
+        case 4: return band % 2; // odd / even
+        default: return band;
     }
 }
 
@@ -335,18 +1308,19 @@ void Sjf_spectralProcessorAudioProcessor::getStateInformation (juce::MemoryBlock
     // as intermediaries to make it easy to save and load complex data.
     for ( int b = 0; b < NUM_BANDS; b++ )
     {
-        bandGainParameter[ b ].setValue( m_bandGains[ b ] );
-        polarityParameter[ b ].setValue( m_polarites[ b ] );
+        // read through the getters so changes the audio thread hasn't applied yet are saved too
+        bandGainParameter[ b ].setValue( getBandGain( b ) );
+        polarityParameter[ b ].setValue( getBandPolarity( b ) );
 
-        lfosOnOffParameter[ b ].setValue( m_lfosOnOff[ b ] );
-        lfoRateParameter[ b ].setValue( m_lfoRates[ b ] );
-        lfoDepthParameter[ b ].setValue( m_lfoDepths[ b ] );
-        lfoOffsetParameter[ b ].setValue( m_lfoOffsets[ b ] );
+        lfosOnOffParameter[ b ].setValue( getLfoOn( b ) );
+        lfoRateParameter[ b ].setValue( getLFORate( b ) );
+        lfoDepthParameter[ b ].setValue( getLFODepth( b ) );
+        lfoOffsetParameter[ b ].setValue( getLFOOffset( b ) );
 
-        delayTimeParameter[ b ].setValue( m_delayTimes[ b ] );
-        feedbackParameter[ b ].setValue( m_feedbacks[ b ] );
-        delayMixParameter[ b ].setValue( m_delayMix[ b ] );
-        delaysOnOffParameter[ b ].setValue( m_delaysOnOff[ b ] );
+        delayTimeParameter[ b ].setValue( getDelayTime( b ) );
+        feedbackParameter[ b ].setValue( getFeedback( b ) );
+        delayMixParameter[ b ].setValue( getDelayMix( b ) );
+        delaysOnOffParameter[ b ].setValue( getDelayOn( b ) );
     }
     
     for ( int b = 0; b < NUM_BANDS; b++ )
@@ -365,6 +1339,7 @@ void Sjf_spectralProcessorAudioProcessor::getStateInformation (juce::MemoryBlock
             delayMixPresetsParameter[ i ][ b ].setValue( m_delayMixPresets[ i ][ b ] );
         }
     }
+    parameters.state.setProperty( "customFeedbackMatrix", m_feedbackMatrix.toString(), nullptr );
     auto state = parameters.copyState();
     
     std::unique_ptr<juce::XmlElement> xml (state.createXml());
@@ -384,6 +1359,11 @@ void Sjf_spectralProcessorAudioProcessor::setStateInformation (const void* data,
         if (xmlState->hasTagName (parameters.state.getType()))
         {
             parameters.replaceState (juce::ValueTree::fromXml (*xmlState));
+            if ( parameters.state.hasProperty( "customFeedbackMatrix" ) )
+            {
+                sjf_feedbackMatrix< NUM_BANDS > loaded;
+                if ( loaded.fromString( parameters.state.getProperty( "customFeedbackMatrix" ).toString() ) ) { setCustomFeedbackMatrix( loaded.getCustom() ); }
+            }
             for ( int b = 0; b < NUM_BANDS; b++ )
             {
                 for ( int i = 0; i < m_bandGainsPresets.size(); i++ )
@@ -420,18 +1400,19 @@ void Sjf_spectralProcessorAudioProcessor::setStateInformation (const void* data,
             
             for ( int b = 0; b < NUM_BANDS; b++ )
             {
-                m_bandGains[ b ] = (float)bandGainParameter[ b ].getValue();
-                m_polarites[ b ] =  (bool)polarityParameter[ b ].getValue();
-                m_lfoRates[ b ] = (float)lfoRateParameter[ b ].getValue();
-                m_lfoDepths[ b ] =  (float)lfoDepthParameter[ b ].getValue();
-                m_lfoOffsets[ b ] = (float)lfoOffsetParameter[ b ].getValue();
+                // handed to the audio thread with the next block, like any other change from the message thread
+                queueBandValue( bandChanges::bandGain, b, (float)bandGainParameter[ b ].getValue() );
+                queueBandValue( bandChanges::polarity, b, (bool)polarityParameter[ b ].getValue() ? 1.0f : 0.0f );
+                queueBandValue( bandChanges::lfoRate, b, (float)lfoRateParameter[ b ].getValue() );
+                queueBandValue( bandChanges::lfoDepth, b, (float)lfoDepthParameter[ b ].getValue() );
+                queueBandValue( bandChanges::lfoOffset, b, (float)lfoOffsetParameter[ b ].getValue() );
                 
-                m_delayTimes[ b ] = (float)delayTimeParameter[ b ].getValue();
-                m_feedbacks[ b ] = (float)feedbackParameter[ b ].getValue();
-                m_delayMix[ b ] = (float)delayMixParameter[ b ].getValue();
+                queueBandValue( bandChanges::delayTime, b, (float)delayTimeParameter[ b ].getValue() );
+                queueBandValue( bandChanges::feedback, b, (float)feedbackParameter[ b ].getValue() );
+                queueBandValue( bandChanges::delayMix, b, (float)delayMixParameter[ b ].getValue() );
                 
-                m_delaysOnOff[ b ] = (bool)delaysOnOffParameter[ b ].getValue();
-                m_lfosOnOff[ b ] = (bool)lfosOnOffParameter[ b ].getValue();
+                queueBandValue( bandChanges::delayOn, b, (bool)delaysOnOffParameter[ b ].getValue() ? 1.0f : 0.0f );
+                queueBandValue( bandChanges::lfoOn, b, (bool)lfosOnOffParameter[ b ].getValue() ? 1.0f : 0.0f );
             }
             
             for ( int b = 0; b < NUM_BANDS; b++ )
@@ -453,65 +1434,224 @@ void Sjf_spectralProcessorAudioProcessor::setStateInformation (const void* data,
             }
         }
         
-        m_parametersChangedFlag = true;
+        markParametersChanged( allParameterGroups );
+        m_delayLinesRequested = true;
         
         DBG( "Finished set state" );
     }
 }
 
 //==============================================================================
-void Sjf_spectralProcessorAudioProcessor::setFilterDesign( const int filterDesign )
+void Sjf_spectralProcessorAudioProcessor::parameterChanged( const juce::String& parameterID, float newValue )
 {
-    for ( int c = 0; c < m_filters.size(); c++ )
+    // every listened to parameter changes the delay memory layout, this can be called from the audio thread
+    // so the arena is resized later on the message thread
+    juce::ignoreUnused( parameterID, newValue );
+    m_delayLinesRequested = true;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::timerCallback()
+{
+    applyMidiParameterChanges();
+    if ( m_delayLinesRequested.exchange( false ) ) { reallocateDelayLines(); }
+    if ( m_staticKernelRequested.exchange( false ) ) { rebuildStaticKernel(); }
+}
+//==============================================================================
+int Sjf_spectralProcessorAudioProcessor::getFilterTableIndex( const bool multirate, const int filterDesign, const int filterOrder )
+{
+    static constexpr int numDesigns = sjf_cascadeDesigner::NUM_DESIGNS, numOrders = sjf_cascadeDesigner::MAX_ORDER - sjf_cascadeDesigner::MIN_ORDER + 1;
+    auto design = juce::jlimit( 0, numDesigns - 1, filterDesign - sjf_cascadeDesigner::FIRST_DESIGN );
+    auto order = juce::jlimit( 0, numOrders - 1, filterOrder - sjf_cascadeDesigner::MIN_ORDER );
+    return ( ( ( multirate ? 1 : 0 ) * numDesigns + design ) * numOrders + order ) * NUM_BANDS;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::selectFilters( const int filterDesign, const int filterOrder )
+{
+    if ( filterDesign == m_filterDesign && filterOrder == m_filterOrder ) { return; }
+    m_bandDesigns = m_filterTable->data() + getFilterTableIndex( m_multirateActive, filterDesign, filterOrder );
+    m_sidechainDesigns = m_filterTable->data() + getFilterTableIndex( false, filterDesign, filterOrder );
+    m_filterKernel = sjf_cascadeKernels::get( m_kernelLevel );
+    m_filterDesign = filterDesign;
+    m_filterOrder = filterOrder;
+    resetFilters();
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::resetFilters()
+{
+    for ( auto& channel : m_filters ) { std::copy( m_bandDesigns, m_bandDesigns + NUM_BANDS, channel.begin() ); }
+    for ( auto& channel : m_sidechainFilters ) { std::copy( m_sidechainDesigns, m_sidechainDesigns + NUM_BANDS, channel.begin() ); }
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::initialiseFilters( double sampleRate )
+{
+    // the band levels are set by initialiseMultirate, they only depend on the sample rate but are part of the key in case that changes
+    const auto bandLevels = m_bandLevels;
+    m_filterTable = filterTableCache::get( { sampleRate, bandLevels }, [ sampleRate, &bandLevels ] { return calculateFilterTable( sampleRate, bandLevels ); } );
+    // the highest order first, so whatever the cascades hold is already as big as it gets before the audio thread copies into them
+    m_filterOrder = 0;
+    selectFilters( (int)*filterDesignParameter, sjf_cascadeDesigner::MAX_ORDER );
+    m_filterOrder = 0; // force selectFilters to repoint and reset the filters
+    selectFilters( (int)*filterDesignParameter, (int)*filterOrderParameter );
+}
+//==============================================================================
+Sjf_spectralProcessorAudioProcessor::filterTable Sjf_spectralProcessorAudioProcessor::calculateFilterTable( const double sampleRate, const std::array< int, NUM_BANDS >& bandLevels )
+{
+    const int lastDesign = sjf_cascadeDesigner::FIRST_DESIGN + sjf_cascadeDesigner::NUM_DESIGNS - 1;
+    filterTable table( (size_t)getFilterTableIndex( true, lastDesign, sjf_cascadeDesigner::MAX_ORDER ) + NUM_BANDS );
+    for ( auto multirate : { false, true } )
     {
-        for ( int f = 0; f < NUM_BANDS; f++ )
+        for ( int design = sjf_cascadeDesigner::FIRST_DESIGN; design <= lastDesign; design++ )
         {
-            m_filters[ c ][ f ].setFilterDesign( filterDesign );
+            for ( int order = sjf_cascadeDesigner::MIN_ORDER; order <= sjf_cascadeDesigner::MAX_ORDER; order++ )
+            {
+                auto* designs = table.data() + getFilterTableIndex( multirate, design, order );
+                for ( int f = 0; f < NUM_BANDS; f++ )
+                {
+                    auto bandRate = sampleRate / (double)( 1 << ( multirate ? bandLevels[ f ] : 0 ) );
+                    using calculator = sjf_biquadCalculator< double >;
+                    auto type = f == 0 ? calculator::filterType::lowpass : f == NUM_BANDS - 1 ? calculator::filterType::highpass : calculator::filterType::bandpass;
+                    designs[ f ] = sjf_cascadeDesigner::calculate( type, design, order, frequencies[ f ], bandRate );
+                }
+            }
         }
     }
+    return table;
 }
 //==============================================================================
-
-void Sjf_spectralProcessorAudioProcessor::setFilterOrder( const int filterOrder )
+void Sjf_spectralProcessorAudioProcessor::initialiseMultirate( double sampleRate )
 {
-    for ( int c = 0; c < m_filters.size(); c++ )
+    int numLevels = 0;
+    for ( int b = 0; b < NUM_BANDS; b++ )
     {
-        for ( int f = 0; f < NUM_BANDS; f++ )
-        {
-            m_filters[ c ][ f ].setNumOrders( filterOrder );
-        }
+        m_bandLevels[ b ] = calculateBandLevel( sampleRate, b );
+        numLevels = std::max( numLevels, m_bandLevels[ b ] );
     }
+    for ( auto& tree : m_multirateTrees ) { tree.initialise( numLevels ); }
 }
 //==============================================================================
-
-void Sjf_spectralProcessorAudioProcessor::initialiseFilters( double sampleRate)
+void Sjf_spectralProcessorAudioProcessor::setMultirate( const bool shouldBeMultirate )
 {
-    //    m_biquadCalculator.initialise( sampleRate );
+    m_multirateActive = shouldBeMultirate;
+    for ( int b = 0; b < NUM_BANDS; b++ ) { m_bandTickMasks[ b ] = m_multirateActive ? ( 1 << m_bandLevels[ b ] ) - 1 : 0; }
+    m_filterOrder = 0; // force selectFilters to repoint and reset the filters
+    selectFilters( (int)*filterDesignParameter, (int)*filterOrderParameter );
+    for ( auto& tree : m_multirateTrees ) { tree.reset(); }
+    setLatencySamples( m_multirateActive ? m_multirateTrees[ 0 ].getLatencySamples( m_multirateTrees[ 0 ].getNumLevels() ) : 0 );
+}
+//==============================================================================
+int Sjf_spectralProcessorAudioProcessor::calculateBandLevel( const double sampleRate, const int band )
+{
+    // the highpass band covers everything up to nyquist
+    if ( band == NUM_BANDS - 1 ) { return 0; }
+    // keep content up to two octaves above the band inside the halfband passband ( ~0.29 of the decimated rate )
+    int level = 0;
+    while ( level < MAX_MULTIRATE_LEVELS && sampleRate / (double)( 1 << ( level + 1 ) ) >= 14.0 * frequencies[ band ] ) { level++; }
+    return level;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::initialiseDelayLines( double sampleRate )
+{
+    m_delayStorage = getDelayStorageSetting();
+    auto bytesPerSample = sjf_delayStorageBytes( m_delayStorage );
+    // only reallocates if the layout has changed since the last prepareToPlay, otherwise the old lines are cleared
+    auto reallocated = m_delayArena.prepare( calculateDelayLineSizes( sampleRate, bytesPerSample ), bytesPerSample );
+    attachDelayLines( reallocated );
+}
+//==============================================================================
+std::vector< int > Sjf_spectralProcessorAudioProcessor::calculateDelayLineSizes( const double sampleRate, const int bytesPerSample )
+{
+    static constexpr int minLineSize = 64;
+    std::vector< int > sizes( NUM_BANDS * NUM_CHANNELS, 0 );
+    // longest delay processBlock can ask for, including the +20% random fluctuations
+    auto maxDelaySamples = (int)std::ceil( ( 1.0 + *maxDelayTimeParameter * sampleRate ) * 1.2 );
+    const bool multirate = getMultirateSetting();
     
-    setFilterDesign( *filterDesignParameter );
-    setFilterOrder( *filterOrderParameter );
-    for ( int c = 0; c < m_filters.size(); c++ )
+    // ( size wanted, band ) for every band with its delay on, decimated bands need proportionally less
+    std::vector< std::pair< int, int > > requests;
+    for ( int b = 0; b < NUM_BANDS; b++ )
     {
-        for ( int f = 0; f < NUM_BANDS; f++ )
-        {
-            m_filters[ c ][ f ].initialise( sampleRate );
-            if ( f == 0 ){ m_filters[ c ][ f ].setFilterType( sjf_biquadCalculator<double>::filterType::lowpass ); }
-            else if ( f == NUM_BANDS-1 ){ m_filters[ c ][ f ].setFilterType( sjf_biquadCalculator<double>::filterType::highpass ); }
-            else { m_filters[ c ][ f ].setFilterType( sjf_biquadCalculator<double>::filterType::bandpass ); }
-            m_filters[ c ][ f ].setFrequency( frequencies[ f ] );
-        }
+        if ( !getDelayOn( b ) ) { continue; }
+        requests.push_back( { sjf_bandDelay< 2 >::getBufferSize( maxDelaySamples >> ( multirate ? m_bandLevels[ b ] : 0 ) ), b } );
+    }
+    std::sort( requests.begin(), requests.end() );
+    
+    // smallest requests first, whatever they don't need is shared between the rest
+    // a band whose share can't even hold the shortest line gets none, so the total never goes over the budget
+    auto remaining = (juce::int64)*delayMemoryParameter * 1024 * 1024 / ( bytesPerSample * NUM_CHANNELS );
+    auto numLeft = (juce::int64)requests.size();
+    for ( auto& request : requests )
+    {
+        auto share = remaining / numLeft--;
+        auto size = request.first;
+        while ( size > share && size > minLineSize ) { size /= 2; }
+        if ( size > share ) { size = 0; }
+        for ( int c = 0; c < NUM_CHANNELS; c++ ) { sizes[ request.second * NUM_CHANNELS + c ] = size; }
+        remaining -= size;
     }
+    return sizes;
 }
 //==============================================================================
-void Sjf_spectralProcessorAudioProcessor::initialiseDelayLines( double sampleRate )
+void Sjf_spectralProcessorAudioProcessor::attachDelayLines( const bool linesAreClear )
+{
+    auto bytesPerSample = sjf_delayStorageBytes( m_delayStorage );
+    for ( int b = 0; b < NUM_BANDS; b++ )
+    {
+        m_delays[ b ].initialise( getDelayLines( b ), m_delayArena.getLineSize( b * NUM_CHANNELS ), bytesPerSample, linesAreClear );
+    }
+    storeDelayLimits( getSampleRate() );
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::storeDelayLimits( const double sampleRate )
 {
+    if ( sampleRate <= 0.0 ) { return; }
+    // the lines were sized with the multirate setting, so the longest delay is converted back to seconds with it too
+    const bool multirate = getMultirateSetting();
     for ( int b = 0; b < NUM_BANDS; b++ )
     {
-        for ( int c = 0; c < 2; c ++ )
+        auto limit = m_delays[ b ].hasBuffers() ? m_delays[ b ].getMaxDelay() * (double)( 1 << ( multirate ? m_bandLevels[ b ] : 0 ) ) / sampleRate : 0.0;
+        m_delayLimitSeconds[ b ].store( (float)limit );
+    }
+}
+//==============================================================================
+std::array< void*, NUM_CHANNELS > Sjf_spectralProcessorAudioProcessor::getDelayLines( const int band ) const
+{
+    std::array< void*, NUM_CHANNELS > lines;
+    for ( int c = 0; c < NUM_CHANNELS; c++ ) { lines[ c ] = m_delayArena.getLine< char >( band * NUM_CHANNELS + c ); }
+    return lines;
+}
+//==============================================================================
+void Sjf_spectralProcessorAudioProcessor::reallocateDelayLines()
+{
+    // before the first prepareToPlay there is no rate to size for, prepareToPlay will do it
+    if ( m_preparedSampleRate <= 0.0 ) { return; }
+    auto storage = getDelayStorageSetting();
+    auto bytesPerSample = sjf_delayStorageBytes( storage );
+    auto sizes = calculateDelayLineSizes( m_preparedSampleRate, bytesPerSample );
+    if ( m_delayArena.matches( sizes, bytesPerSample ) ) { return; }
+    
+    // the new (zeroed) memory is allocated before taking the lock and the old memory is freed after releasing it,
+    // so the audio thread only waits for the swap
+    sjf_delayArena arena;
+    arena.prepare( sizes, bytesPerSample );
+    {
+        const juce::ScopedLock lock( getCallbackLock() );
+        // lines that keep their length and format are copied across and carry on, only the bands that changed start empty
+        std::array< bool, NUM_BANDS > keep {};
+        for ( int b = 0; b < NUM_BANDS; b++ )
         {
-            m_delayLines[ c ][ b ].initialise( sampleRate );
+            auto line = b * NUM_CHANNELS;
+            keep[ b ] = storage == m_delayStorage && m_delays[ b ].hasBuffers() && m_delayArena.getNumLines() == arena.getNumLines() && m_delayArena.getLineSize( line ) == arena.getLineSize( line );
+            if ( keep[ b ] ) { for ( int c = 0; c < NUM_CHANNELS; c++ ) { arena.copyLine( m_delayArena, line + c ); } }
+        }
+        std::swap( m_delayArena, arena );
+        m_delayStorage = storage;
+        for ( int b = 0; b < NUM_BANDS; b++ )
+        {
+            if ( keep[ b ] ) { m_delays[ b ].moveBuffers( getDelayLines( b ) ); }
+            else { m_delays[ b ].initialise( getDelayLines( b ), m_delayArena.getLineSize( b * NUM_CHANNELS ), bytesPerSample, true ); }
         }
     }
+    storeDelayLimits( m_preparedSampleRate );
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::initialiseSmoothers( double sampleRate )
@@ -525,6 +1665,8 @@ void Sjf_spectralProcessorAudioProcessor::initialiseSmoothers( double sampleRate
         m_gainSmoother[ b ].setCutoff( calculateLPFCoefficient<float>( 5.0f, (float)sampleRate ) );
         m_lfoSmoother[ b ].setCutoff( calculateLPFCoefficient<float>( 1.0f, (float)sampleRate ) );
     }
+    m_delayModDepthSmoother.setCutoff( calculateLPFCoefficient<float>( 1.0f, (float)sampleRate ) );
+    m_delayModSpreadSmoother.setCutoff( calculateLPFCoefficient<float>( 1.0f, (float)sampleRate ) );
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::initialiseLFOs( double sampleRate)
@@ -534,9 +1676,17 @@ void Sjf_spectralProcessorAudioProcessor::initialiseLFOs( double sampleRate)
     for ( int f = 0; f < NUM_BANDS; f++ )
     {
         m_lfos[ f ].setSampleRate( sampleRate );
+        // staggered so neighbouring bands don't move together
+        m_delayLfos.setPhase( f, sjf_phasorBank< NUM_BANDS >::wrap( f * 0.618034f ) );
     }
 }
 //==============================================================================
+float Sjf_spectralProcessorAudioProcessor::getDelayLfoRateRatio( const int band )
+{
+    // each band's delay lfo runs somewhere between 0.75 and 1.25 times the set rate
+    return 0.75f + 0.5f * sjf_phasorBank< NUM_BANDS >::wrap( ( band + 1 ) * 0.381966f );
+}
+//==============================================================================
 void Sjf_spectralProcessorAudioProcessor::initialiseDCBlock( double sampleRate )
 {
     float dcCutoff = calculateLPFCoefficient< float > ( 15, getSampleRate() );
@@ -546,104 +1696,133 @@ void Sjf_spectralProcessorAudioProcessor::initialiseDCBlock( double sampleRate )
     }
 }
 //==============================================================================
+double Sjf_spectralProcessorAudioProcessor::calculateTailLengthSeconds()
+{
+    // decay we wait for before calling something silent (-100dB, same as the silence detector)
+    static constexpr double decayAmplitude = 0.00001;
+    auto SR = getSampleRate();
+    if ( SR <= 0 ) { return 0.0; }
+    
+    // rough ring time for the filter bank, dominated by the lowest band, plus the 15Hz second order dc filter
+    double tail = ( (double)*filterOrderParameter * 2.0 / frequencies[ 0 ] ) + ( 2.0 * std::log( 1.0 / decayAmplitude ) / ( juce::MathConstants< double >::twoPi * 15.0 ) );
+    
+    // anything still in the multirate tree's compensation delays comes out after the input stops
+    tail += getLatencySamples() / SR;
+    
+    for ( int b = 0; b < NUM_BANDS; b++ )
+    {
+        if ( !m_delaysOnOff[ b ] || !m_delays[ b ].hasBuffers() ) { continue; }
+        // same scaling as processBlock, including the +20% the random fluctuations can add and the modulation depth,
+        // but never longer than the line can actually hold once the memory budget has shortened it
+        auto delaySeconds = ( 1.0 + *maxDelayTimeParameter * m_delayTimes[ b ] * SR ) * 1.2 / SR + *delayModDepthParameter * 0.001;
+        delaySeconds = std::fmin( delaySeconds, m_delays[ b ].getMaxDelay() * ( m_bandTickMasks[ b ] + 1 ) / SR );
+        auto feedback = m_feedbacks[ b ] * 0.999;
+        auto repeats = 1.0;
+        if ( feedback > 0.0 ) { repeats += std::log( decayAmplitude ) / std::log( feedback ); }
+        tail = std::fmax( tail, delaySeconds * repeats );
+    }
+    return tail;
+}
+//==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setBandGain( const int bandNumber, const double gain )
 {
-    m_bandGains[ bandNumber ] = gain;
+    markParametersChanged( queueBandValue( bandChanges::bandGain, bandNumber, (float)gain ) );
 }
 //==============================================================================
 const double Sjf_spectralProcessorAudioProcessor::getBandGain( const int bandNumber )
 {
-    return m_bandGains[ bandNumber ];
+    return readBandValue( bandChanges::bandGain, bandNumber );
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setBandPolarity( const int bandNumber, const bool flip )
 {
-    m_polarites[ bandNumber ] = flip;
+    markParametersChanged( queueBandValue( bandChanges::polarity, bandNumber, ( flip ? 1.0f : 0.0f ) ) );
 }
 //==============================================================================
 const bool Sjf_spectralProcessorAudioProcessor::getBandPolarity( const int bandNumber )
 {
-    return m_polarites[ bandNumber ];
+    return readBandValue( bandChanges::polarity, bandNumber ) > 0.5f;
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setLFORate( const int bandNumber, const double lfoR )
 {
-    m_lfoRates[ bandNumber ] = lfoR;
+    markParametersChanged( queueBandValue( bandChanges::lfoRate, bandNumber, (float)lfoR ) );
 }
 //==============================================================================
 const double Sjf_spectralProcessorAudioProcessor::getLFORate( const int bandNumber )
 {
-    return m_lfoRates[ bandNumber ];
+    return readBandValue( bandChanges::lfoRate, bandNumber );
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setLFODepth( const int bandNumber, const double lfoD )
 {
-    m_lfoDepths[ bandNumber ] = lfoD;
+    markParametersChanged( queueBandValue( bandChanges::lfoDepth, bandNumber, (float)lfoD ) );
 }
 //==============================================================================
 const double Sjf_spectralProcessorAudioProcessor::getLFODepth( const int bandNumber )
 {
-    return m_lfoDepths[ bandNumber ];
+    return readBandValue( bandChanges::lfoDepth, bandNumber );
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setLFOOffset( const int bandNumber, const double lfoOffset )
 {
-    m_lfoOffsets[ bandNumber ] = lfoOffset;
+    markParametersChanged( queueBandValue( bandChanges::lfoOffset, bandNumber, (float)lfoOffset ) );
 }
 //==============================================================================
 const double Sjf_spectralProcessorAudioProcessor::getLFOOffset( const int bandNumber )
 {
-    return m_lfoOffsets[ bandNumber ];
+    return readBandValue( bandChanges::lfoOffset, bandNumber );
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setDelayTime( const int bandNumber, const double delay )
 {
-    m_delayTimes[ bandNumber ] = delay;
+    markParametersChanged( queueBandValue( bandChanges::delayTime, bandNumber, (float)delay ) );
 }
 //==============================================================================
 const double Sjf_spectralProcessorAudioProcessor::getDelayTime( const int bandNumber )
 {
-    return m_delayTimes[ bandNumber ];
+    return readBandValue( bandChanges::delayTime, bandNumber );
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setFeedback( const int bandNumber, const double fb )
 {
-    m_feedbacks[ bandNumber ] = fb;
+    markParametersChanged( queueBandValue( bandChanges::feedback, bandNumber, (float)fb ) );
 }
 //==============================================================================
 const double Sjf_spectralProcessorAudioProcessor::getFeedback( const int bandNumber )
 {
-    return m_feedbacks[ bandNumber ];
+    return readBandValue( bandChanges::feedback, bandNumber );
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setDelayMix( const int bandNumber, const double delayMix )
 {
-    m_delayMix[ bandNumber ] = delayMix;
+    markParametersChanged( queueBandValue( bandChanges::delayMix, bandNumber, (float)delayMix ) );
 }
 //==============================================================================
 const double Sjf_spectralProcessorAudioProcessor::getDelayMix( const int bandNumber )
 {
-    return m_delayMix[ bandNumber ];
+    return readBandValue( bandChanges::delayMix, bandNumber );
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setDelayOn( const int bandNumber, const bool delayIsOn )
 {
-    m_delaysOnOff[ bandNumber ] = delayIsOn;
+    markParametersChanged( queueBandValue( bandChanges::delayOn, bandNumber, ( delayIsOn ? 1.0f : 0.0f ) ) );
+    m_delayLinesRequested = true;
 }
 //==============================================================================
 const bool Sjf_spectralProcessorAudioProcessor::getDelayOn( const int bandNumber )
 {
-    return m_delaysOnOff[ bandNumber ];
+    return readBandValue( bandChanges::delayOn, bandNumber ) > 0.5f;
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setLfoOn( const int bandNumber, const bool lfoIsOn )
 {
-    m_lfosOnOff[ bandNumber ] = lfoIsOn;
+    markParametersChanged( queueBandValue( bandChanges::lfoOn, bandNumber, ( lfoIsOn ? 1.0f : 0.0f ) ) );
 }
 //==============================================================================
 const bool Sjf_spectralProcessorAudioProcessor::getLfoOn( const int bandNumber )
 {
-    return m_lfosOnOff[ bandNumber ];
+    return readBandValue( bandChanges::lfoOn, bandNumber ) > 0.5f;
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::setBandGain( const int presetNumber, const int bandNumber, const double gain )
@@ -728,58 +1907,120 @@ const double Sjf_spectralProcessorAudioProcessor::getDelayMix( const int presetN
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::getPreset(const int presetNumber)
 {
+    markParametersChanged( recallPreset( presetNumber, &Sjf_spectralProcessorAudioProcessor::queueBandValue ) );
+}
+//==============================================================================
+juce::uint32 Sjf_spectralProcessorAudioProcessor::recallPreset( const int presetNumber, const bandWriter write )
+{
+    juce::uint32 changed = 0;
     for ( int b = 0; b < NUM_BANDS; b++ )
     {
-        m_bandGains[ b ] = m_bandGainsPresets[ presetNumber ][ b ];
-        m_polarites[ b ] = m_polarityPresets[ presetNumber ][ b ];
+        changed |= ( this->*write )( bandChanges::bandGain, b, m_bandGainsPresets[ presetNumber ][ b ] );
+        changed |= ( this->*write )( bandChanges::polarity, b, m_polarityPresets[ presetNumber ][ b ] ? 1.0f : 0.0f );
         
-        m_lfoRates[ b ] = m_lfoRatesPresets[ presetNumber ][ b ];
-        m_lfoDepths[ b ] = m_lfoDepthsPresets[ presetNumber ][ b ];
-        m_lfoOffsets[ b ] = m_lfoOffsetsPresets[ presetNumber ][ b ];
-        m_delayTimes[ b ] = m_delayTimesPresets[ presetNumber ][ b ];
-        m_feedbacks[ b ] = m_feedbacksPresets[ presetNumber ][ b ];
-        m_delayMix[ b ] = m_delayMixPresets[ presetNumber ][ b ];
+        changed |= ( this->*write )( bandChanges::lfoRate, b, m_lfoRatesPresets[ presetNumber ][ b ] );
+        changed |= ( this->*write )( bandChanges::lfoDepth, b, m_lfoDepthsPresets[ presetNumber ][ b ] );
+        changed |= ( this->*write )( bandChanges::lfoOffset, b, m_lfoOffsetsPresets[ presetNumber ][ b ] );
+        changed |= ( this->*write )( bandChanges::delayTime, b, m_delayTimesPresets[ presetNumber ][ b ] );
+        changed |= ( this->*write )( bandChanges::feedback, b, m_feedbacksPresets[ presetNumber ][ b ] );
+        changed |= ( this->*write )( bandChanges::delayMix, b, m_delayMixPresets[ presetNumber ][ b ] );
+    }
+    return changed;
+}
+//==============================================================================
+juce::uint32 Sjf_spectralProcessorAudioProcessor::writeBandValue( const int field, const int band, const float value )
+{
+    static_assert( bandGainGroup == 1u << bandChanges::bandGain && delayMixGroup == 1u << bandChanges::delayMix, "the band change fields must be in the same order as the parameter groups" );
+    bool changed = false;
+    auto write = [ &changed ]( auto& current, const auto newValue )
+    {
+        changed = current != newValue;
+        current = newValue;
+    };
+    switch ( field )
+    {
+        case bandChanges::bandGain: write( m_bandGains[ band ], value ); break;
+        case bandChanges::polarity: write( m_polarites[ band ], value > 0.5f ); break;
+        case bandChanges::lfoOn: write( m_lfosOnOff[ band ], value > 0.5f ); break;
+        case bandChanges::lfoDepth: write( m_lfoDepths[ band ], value ); break;
+        case bandChanges::lfoRate: write( m_lfoRates[ band ], value ); break;
+        case bandChanges::lfoOffset: write( m_lfoOffsets[ band ], value ); break;
+        case bandChanges::delayOn: write( m_delaysOnOff[ band ], value > 0.5f ); break;
+        case bandChanges::delayTime: write( m_delayTimes[ band ], value ); break;
+        case bandChanges::feedback: write( m_feedbacks[ band ], value ); break;
+        case bandChanges::delayMix: write( m_delayMix[ band ], value ); break;
+        default: break;
+    }
+    return changed ? 1u << field : 0;
+}
+//==============================================================================
+juce::uint32 Sjf_spectralProcessorAudioProcessor::queueBandValue( const int field, const int band, const float value )
+{
+    if ( readBandValue( field, band ) == value ) { return 0; }
+    m_bandChanges.set( field, band, value );
+    return 1u << field;
+}
+//==============================================================================
+float Sjf_spectralProcessorAudioProcessor::readBandValue( const int field, const int band ) const
+{
+    // a change the audio thread hasn't picked up yet is what the editor and the saved state should see
+    float value;
+    if ( m_bandChanges.get( field, band, value ) ) { return value; }
+    switch ( field )
+    {
+        case bandChanges::bandGain: return m_bandGains[ band ];
+        case bandChanges::polarity: return m_polarites[ band ] ? 1.0f : 0.0f;
+        case bandChanges::lfoOn: return m_lfosOnOff[ band ] ? 1.0f : 0.0f;
+        case bandChanges::lfoDepth: return m_lfoDepths[ band ];
+        case bandChanges::lfoRate: return m_lfoRates[ band ];
+        case bandChanges::lfoOffset: return m_lfoOffsets[ band ];
+        case bandChanges::delayOn: return m_delaysOnOff[ band ] ? 1.0f : 0.0f;
+        case bandChanges::delayTime: return m_delayTimes[ band ];
+        case bandChanges::feedback: return m_feedbacks[ band ];
+        case bandChanges::delayMix: return m_delayMix[ band ];
+        default: return 0.0f;
     }
-    m_parametersChangedFlag = true;
 }
 //==============================================================================
 void Sjf_spectralProcessorAudioProcessor::interpolatePresets( std::array< float, 4 > weights )
+{
+    markParametersChanged( interpolatePresets( weights, &Sjf_spectralProcessorAudioProcessor::queueBandValue ) );
+}
+//==============================================================================
+juce::uint32 Sjf_spectralProcessorAudioProcessor::interpolatePresets( std::array< float, 4 > weights, const bandWriter write )
 {
     float total = 0.0f;
     for ( int i = 0; i < weights.size(); i++ ) { total += weights[ i ]; }
     for ( int i = 0; i < weights.size(); i++ ) { weights[ i ] /= total; }
     
-    std::array< float, NUM_BANDS > polarityFlips;
-    for ( int b = 0; b < NUM_BANDS; b++ )
-    {
-        m_bandGains[ b ] = 0;
-        polarityFlips[ b ] = 0;
-        m_polarites[ b ] = false;
-        m_lfoRates[ b ] = 0;
-        m_lfoDepths[ b ] = 0;
-        m_lfoOffsets[ b ] = 0;
-        m_delayTimes[ b ] = 0;
-        m_feedbacks[ b ] = 0;
-        m_delayMix[ b ] = 0;
-    }
+    // sums are built locally and each value written once, and only the groups that actually moved get flagged for the editor
+    juce::uint32 changed = 0;
     for ( int b = 0; b < NUM_BANDS; b++ )
     {
+        float bandGain = 0, polarityFlip = 0, lfoRate = 0, lfoDepth = 0, lfoOffset = 0, delayTime = 0, feedback = 0, delayMix = 0;
         for ( int i = 0; i < weights.size(); i++ )
         {
-            m_bandGains[ b ] += m_bandGainsPresets[ i ][ b ]*weights[ i ];
-            if (m_polarityPresets[ i ][ b ]){ polarityFlips[ b ] += weights[ i ]; }
-            else { polarityFlips[ b ] -= weights[ i ]; }
+            bandGain += m_bandGainsPresets[ i ][ b ]*weights[ i ];
+            if (m_polarityPresets[ i ][ b ]){ polarityFlip += weights[ i ]; }
+            else { polarityFlip -= weights[ i ]; }
             
-            m_lfoRates[ b ] += m_lfoRatesPresets[ i ][ b ]*weights[ i ];
-            m_lfoDepths[ b ] += m_lfoDepthsPresets[ i ][ b ]*weights[ i ];
-            m_lfoOffsets[ b ] += m_lfoOffsetsPresets[ i ][ b ]*weights[ i ];
-            m_delayTimes[ b ] += m_delayTimesPresets[ i ][ b ]*weights[ i ];
-            m_feedbacks[ b ] += m_feedbacksPresets[ i ][ b ]*weights[ i ];
-            m_delayMix[ b ] += m_delayMixPresets[ i ][ b ]*weights[ i ];
+            lfoRate += m_lfoRatesPresets[ i ][ b ]*weights[ i ];
+            lfoDepth += m_lfoDepthsPresets[ i ][ b ]*weights[ i ];
+            lfoOffset += m_lfoOffsetsPresets[ i ][ b ]*weights[ i ];
+            delayTime += m_delayTimesPresets[ i ][ b ]*weights[ i ];
+            feedback += m_feedbacksPresets[ i ][ b ]*weights[ i ];
+            delayMix += m_delayMixPresets[ i ][ b ]*weights[ i ];
         }
-        if ( polarityFlips[ b ] > 0 ) { m_polarites[ b ] = true; }
+        changed |= ( this->*write )( bandChanges::bandGain, b, bandGain );
+        changed |= ( this->*write )( bandChanges::lfoRate, b, lfoRate );
+        changed |= ( this->*write )( bandChanges::lfoDepth, b, lfoDepth );
+        changed |= ( this->*write )( bandChanges::lfoOffset, b, lfoOffset );
+        changed |= ( this->*write )( bandChanges::delayTime, b, delayTime );
+        changed |= ( this->*write )( bandChanges::feedback, b, feedback );
+        changed |= ( this->*write )( bandChanges::delayMix, b, delayMix );
+        changed |= ( this->*write )( bandChanges::polarity, b, polarityFlip > 0 ? 1.0f : 0.0f );
     }
-    m_parametersChangedFlag = true;
+    return changed;
 }
 //==============================================================================
 juce::AudioProcessorValueTreeState::ParameterLayout Sjf_spectralProcessorAudioProcessor::createParameterLayout()
@@ -793,6 +2034,32 @@ juce::AudioProcessorValueTreeState::ParameterLayout Sjf_spectralProcessorAudioPr
     params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "filterDesign", pIDVersionNumber }, "FilterDesign", 1, 3, 1 ) );
     params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "filterOrder", pIDVersionNumber }, "FilterOrder", 2, 8, 4 ) );
     
+    params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "delayInterpolation", pIDVersionNumber }, "DelayInterpolation", 1, 4, 1 ) );
+    
+    params.add( std::make_unique<juce::AudioParameterBool>( juce::ParameterID{ "multirate", pIDVersionNumber }, "Multirate", false ) );
+    params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "auxRouting", pIDVersionNumber }, "AuxRouting", 1, 4, 1 ) );
+    params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "feedbackMatrix", pIDVersionNumber }, "FeedbackMatrix", 1, 4, 1 ) );
+    
+    params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "delayStorage", pIDVersionNumber }, "DelayStorage", 1, 4, 1 ) );
+    
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "maxDelayTime", pIDVersionNumber }, "MaxDelayTime", juce::NormalisableRange< float >( 0.1f, 8.0f, 0.01f, 0.5f ), 0.1f ) );
+    params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "delayMemory", pIDVersionNumber }, "DelayMemory", 1, 512, 32 ) );
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "delayModRate", pIDVersionNumber }, "DelayModRate", juce::NormalisableRange< float >( 0.01f, 10.0f, 0.01f, 0.4f ), 0.5f ) );
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "delayModDepth", pIDVersionNumber }, "DelayModDepth", juce::NormalisableRange< float >( 0.0f, 20.0f, 0.01f, 0.5f ), 0.0f ) );
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "delayModSpread", pIDVersionNumber }, "DelayModSpread", juce::NormalisableRange< float >( 0.0f, 0.5f, 0.01f ), 0.25f ) );
+    
+    params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "dynamicsMode", pIDVersionNumber }, "DynamicsMode", 1, 3, 1 ) );
+    params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "dynamicsDetector", pIDVersionNumber }, "DynamicsDetector", 1, 2, 1 ) );
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "dynamicsThreshold", pIDVersionNumber }, "DynamicsThreshold", juce::NormalisableRange< float >( -60.0f, 0.0f, 0.1f ), -20.0f ) );
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "dynamicsRatio", pIDVersionNumber }, "DynamicsRatio", juce::NormalisableRange< float >( 1.0f, 20.0f, 0.1f, 0.5f ), 2.0f ) );
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "dynamicsAttack", pIDVersionNumber }, "DynamicsAttack", juce::NormalisableRange< float >( 0.1f, 100.0f, 0.1f, 0.5f ), 10.0f ) );
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "dynamicsRelease", pIDVersionNumber }, "DynamicsRelease", juce::NormalisableRange< float >( 5.0f, 2000.0f, 1.0f, 0.5f ), 100.0f ) );
+    params.add( std::make_unique<juce::AudioParameterInt>( juce::ParameterID{ "envelopeTarget", pIDVersionNumber }, "EnvelopeTarget", 1, 3, 1 ) );
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "envelopeAmount", pIDVersionNumber }, "EnvelopeAmount", 0, 1, 0.5f ) );
+    params.add( std::make_unique<juce::AudioParameterBool>( juce::ParameterID{ "vocoder", pIDVersionNumber }, "Vocoder", false ) );
+    params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "vocoderSensitivity", pIDVersionNumber }, "VocoderSensitivity", juce::NormalisableRange< float >( 0.0f, 48.0f, 0.1f ), 12.0f ) );
+    params.add( std::make_unique<juce::AudioParameterBool>( juce::ParameterID{ "governor", pIDVersionNumber }, "Governor", false ) );
+    
     params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "xyPad-X", pIDVersionNumber }, "XyPad-X", 0, 1, 0 ) );
     params.add( std::make_unique<juce::AudioParameterFloat>( juce::ParameterID{ "xyPad-Y", pIDVersionNumber }, "XyPad-Y", 0, 1, 0 ) );
     
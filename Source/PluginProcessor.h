@@ -10,11 +10,23 @@
 
 #include <JuceHeader.h>
 #include "../sjf_audio/sjf_audioUtilities.h"
-#include "../sjf_audio/sjf_biquadCascade.h"
 #include "../sjf_audio/sjf_lfo.h"
-#include "../sjf_audio/sjf_delayLine.h"
 #include "../sjf_audio/sjf_lpf.h"
 #include "../sjf_audio/sjf_audioUtilities.h"
+#include "sjf_silenceDetector.h"
+#include "sjf_spectralMetrics.h"
+#include "sjf_spectrumAnalyser.h"
+#include "sjf_bandDelay.h"
+#include "sjf_delayArena.h"
+#include "sjf_multirate.h"
+#include "sjf_cascadeFilter.h"
+#include "sjf_cpuDispatch.h"
+#include "sjf_feedbackMatrix.h"
+#include "sjf_phasorBank.h"
+#include "sjf_bandDynamics.h"
+#include "sjf_qualityGovernor.h"
+#include "sjf_sharedCache.h"
+#include "sjf_bandChanges.h"
 
 //#define NUM_BANDS 16
 #define ORDER 4
@@ -25,9 +37,14 @@ class Sjf_spectralProcessorAudioProcessor  : public juce::AudioProcessor
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
+                             , private juce::AudioProcessorValueTreeState::Listener
+                             , private juce::Timer
 {
     static const int NUM_BANDS  = 16;
+    static const int MAX_MULTIRATE_LEVELS = 6;
 public:
+    using blockMetrics = sjf_blockMetrics< NUM_BANDS >;
+
     //==============================================================================
     Sjf_spectralProcessorAudioProcessor();
     ~Sjf_spectralProcessorAudioProcessor() override;
@@ -35,6 +52,7 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void processorLayoutsChanged() override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -98,8 +116,23 @@ public:
     void setLfoOn( const int bandNumber, const bool lfoIsOn );
     const bool getLfoOn( const int bandNumber );
     
-    void setParametersChangedFalse() { m_parametersChangedFlag = false; }
-    bool checkIfParametersChanged() { return m_parametersChangedFlag; }
+    // groups of per band values, so the editor only has to update the widgets that changed
+    enum parameterGroup : juce::uint32
+    {
+        bandGainGroup = 1 << 0,
+        polarityGroup = 1 << 1,
+        lfoOnGroup = 1 << 2,
+        lfoDepthGroup = 1 << 3,
+        lfoRateGroup = 1 << 4,
+        lfoOffsetGroup = 1 << 5,
+        delayOnGroup = 1 << 6,
+        delayTimeGroup = 1 << 7,
+        feedbackGroup = 1 << 8,
+        delayMixGroup = 1 << 9,
+        allParameterGroups = ( 1 << 10 ) - 1
+    };
+    // returns the groups changed since the last call and clears them
+    juce::uint32 fetchChangedParameterGroups() { return m_changedParameterGroups.exchange( 0 ); }
     
     
     void setBandGain( const int presetNumber, const int bandNumber, const double gain );
@@ -126,24 +159,174 @@ public:
     void setDelayMix( const int presetNumber, const int bandNumber, const double delayMix );
     const double getDelayMix( const int presetNumber, const int bandNumber );
     
+    // message thread, the recalled settings are handed to the audio thread with the next block
     void getPreset(const int presetNumber);
     
-//    const std::array< double, NUM_BANDS > getFrequencies{ return frequencies; }
+    static std::vector< double > getBandFrequencies() { return { frequencies.begin(), frequencies.end() }; }
     
+    // message thread, like getPreset
     void interpolatePresets( std::array< float, 4 > weights );
     
+    // the preset the last midi program change recalled, -1 if there hasn't been one since the last call
+    int fetchMidiPreset() { return m_midiPreset.exchange( -1 ); }
+    
     void isEditorOpen( const bool editorIsOpen ){ m_editorOpenFlag = editorIsOpen; }
     
+    // metrics are only collected while something is reading them
+    void setMetricsEnabled( const bool shouldCollect ){ m_metricsEnabled = shouldCollect; }
+    bool popMetrics( blockMetrics& record ){ return m_metricsFifo.pop( record ); }
+    
+    sjf_analyserFifo& getAnalyserFifo(){ return m_analyserFifo; }
+    
+    size_t getDelayMemoryBytes() const { return m_delayArena.getFootprintBytes(); }
+    // true while an aux bus is enabled, which holds multirate off whatever the parameter says
+    bool hasAuxOutputs() const { return m_hasAuxOutputs.load(); }
+    // longest delay (in seconds) the band's line can hold after the memory budget has been shared out, 0 if it has none
+    float getDelayLimitSeconds( const int band ) const { return m_delayLimitSeconds[ band ].load(); }
+    // the only randomness outside the noise lfo, seed it before prepareToPlay for renders that can be compared
+    void setRandomSeed( const juce::int64 seed ){ m_random.setSeed( seed ); }
+    
+    // instruction set the kernels were picked for at the last prepareToPlay
+    juce::String getKernelLevelName() const { return sjf_cpuDispatch::getLevelName( m_kernelLevel ); }
+    // true while the static chain's convolution kernel stands in for the bands, only meaningful on the audio thread
+    bool isStaticKernelRunning() const { return m_staticInput; }
+    
+    // one of sjf_qualityGovernor::level, always full while the "governor" parameter is off or rendering offline
+    int getQualityLevel() const { return m_governor.getLevel(); }
+    
+    // used when the "feedbackMatrix" parameter is set to custom, row major and saved with the state.
+    // A matrix with any gain could make the feedback run away, so it's scaled down to a gain of 1 (orthogonal
+    // matrices are kept as they are). Returns false, keeping the old matrix, if any value isn't finite
+    bool setCustomFeedbackMatrix( const std::array< float, NUM_BANDS * NUM_BANDS >& matrix );
+    const std::array< float, NUM_BANDS * NUM_BANDS >& getCustomFeedbackMatrix() const { return m_feedbackMatrix.getCustom(); }
+    
     
 private:
-    void setFilterDesign( const int filterDesign );
-    void setFilterOrder( const int filterOrder );
+    void parameterChanged( const juce::String& parameterID, float newValue ) override;
+    // polls the requests the other threads leave for the message thread
+    void timerCallback() override;
+    
+    // the per band settings are only written on the audio thread, everything else goes through m_bandChanges
+    using bandChanges = sjf_bandChanges< NUM_BANDS >;
+    // writes one per band setting, returns its parameter group if the value changed
+    using bandWriter = juce::uint32 ( Sjf_spectralProcessorAudioProcessor::* )( const int, const int, const float );
+    juce::uint32 writeBandValue( const int field, const int band, const float value );
+    juce::uint32 queueBandValue( const int field, const int band, const float value );
+    float readBandValue( const int field, const int band ) const;
+    juce::uint32 recallPreset( const int presetNumber, const bandWriter write );
+    juce::uint32 interpolatePresets( std::array< float, 4 > weights, const bandWriter write );
+    
+    // offline renders always use the render quality profile: lagrange delay interpolation, float32 delay storage
+    // and exact maths in the modulation and dynamics. Realtime uses the settings as they are. Multirate is left as
+    // it is set, so the latency the host compensates for is the same either way
+    int getDelayStorageSetting() const { return m_renderQuality ? (int)float32Storage : (int)*delayStorageParameter; }
+    // the aux buses need every band at the host rate, so multirate is held off while any of them is enabled
+    bool getMultirateSetting() const { return *multirateParameter > 0.5f && !m_hasAuxOutputs; }
+    
+    void markParametersChanged( const juce::uint32 groups ) { if ( groups != 0 ) { m_changedParameterGroups.fetch_or( groups ); } }
+    void selectFilters( const int filterDesign, const int filterOrder );
+    void resetFilters();
+    static int getFilterTableIndex( const bool multirate, const int filterDesign, const int filterOrder );
     void initialiseFilters( double sampleRate );
+    using filterTable = std::vector< sjf_bandFilter >;
+    static filterTable calculateFilterTable( const double sampleRate, const std::array< int, NUM_BANDS >& bandLevels );
     void initialiseDelayLines( double sampleRate );
+    std::vector< int > calculateDelayLineSizes( const double sampleRate, const int bytesPerSample );
+    void attachDelayLines( const bool linesAreClear );
+    void storeDelayLimits( const double sampleRate );
+    std::array< void*, 2 > getDelayLines( const int band ) const;
+    void reallocateDelayLines();
     void initialiseLFOs( double sampleRate );
+    static float getDelayLfoRateRatio( const int band );
     void initialiseDCBlock( double sampleRate );
     void initialiseSmoothers( double sampleRate );
-    
+    void initialiseMultirate( double sampleRate );
+    void setMultirate( const bool shouldBeMultirate );
+    static int calculateBandLevel( const double sampleRate, const int band );
+    
+    double calculateTailLengthSeconds();
+    
+    void selectKernels();
+    void calculateTargets();
+    static std::array< float, 4 > calculateCorners( const float x, const float y );
+    float getPadPosition( const int axis ) const;
+    void interpolateXY();
+    // returns true if the event changed anything the targets are calculated from
+    bool handleMidiEvent( const juce::uint8* data, const int numBytes );
+    void applyMidiParameterChanges();
+    void processSubBlock( juce::AudioBuffer< float >& buffer, const int startSample, const int numSamples, const int numChannels, const int numInputChannels );
+    SJF_FORCE_INLINE void calculateControlFrames( const int numSamples );
+    void filterBands( const float* input, const int channel, const int numSamples );
+    bool canSkipBand( const int band ) const;
+    // static chain, see m_staticKernel
+    struct staticSpec
+    {
+        std::array< float, NUM_BANDS > gains {};
+        int filterDesign = 0, filterOrder = 0;
+        // copied from the prepared settings under the callback lock when the kernel is built. Not compared,
+        // prepareToPlay throws away any kernel or request made with the old ones
+        double sampleRate = 0.0;
+        int blockSize = 0, kernelLevel = sjf_cpuDispatch::baseline;
+        std::shared_ptr< const filterTable > filters;
+        bool operator== ( const staticSpec& other ) const { return gains == other.gains && filterDesign == other.filterDesign && filterOrder == other.filterOrder; }
+    };
+    struct staticKernel
+    {
+        staticSpec spec;
+        // null if the bands came out cheaper on this machine, they are kept for this spec
+        std::unique_ptr< juce::dsp::Convolution > convolution;
+        int length = 0;
+    };
+    bool chainIsStatic() const;
+    staticSpec getStaticSpec() const;
+    void updateStaticChain();
+    void resetChain();
+    void rebuildStaticKernel();
+    bool updateDualMono( const juce::AudioBuffer< float >& buffer, const int startSample, const int numSamples, const int numChannels, const int numInputChannels, const bool checkModulation );
+    void unlinkChannels();
+    static std::vector< float > calculateStaticImpulse( const staticSpec& spec );
+    static bool staticKernelIsCheaper( juce::dsp::Convolution& convolution, const staticSpec& spec );
+    void filterBandsMultirate( const float* input, const int channel, const int numSamples );
+    void processVocoder( const juce::AudioBuffer< float >& buffer, const int startSample, const int numChannels, const int numSamples );
+    void processDynamics( const int numChannels, const int numSamples );
+    template< int INTERPOLATION, typename STORAGE >
+    SJF_FORCE_INLINE void processDelays( const int numChannels, const int numSamples );
+    template< int INTERPOLATION, typename STORAGE >
+    SJF_FORCE_INLINE void processDelaysMixed( const int numChannels, const int numSamples, const int matrixType );
+    using delayProcessor = void ( Sjf_spectralProcessorAudioProcessor::* )( const int, const int );
+    delayProcessor getDelayProcessor( const int interpolation, const int storage );
+    template< typename STORAGE >
+    delayProcessor getDelayProcessor( const int interpolation );
+    template< int INTERPOLATION, typename STORAGE >
+    delayProcessor getDelayProcessor();
+    SJF_FORCE_INLINE void sumBands( float* output, const int channel, const int numSamples );
+    
+    // the hot stages compiled for each sjf_cpuDispatch level, picked once in selectKernels
+    void calculateControlFramesBaseline( const int numSamples );
+    template< int INTERPOLATION, typename STORAGE >
+    void processDelaysBaseline( const int numChannels, const int numSamples );
+    void sumBandsBaseline( float* output, const int channel, const int numSamples );
+#if SJF_X86_DISPATCH
+    SJF_TARGET_AVX2 void calculateControlFramesAVX2( const int numSamples );
+    template< int INTERPOLATION, typename STORAGE >
+    SJF_TARGET_AVX2 void processDelaysAVX2( const int numChannels, const int numSamples );
+    SJF_TARGET_AVX2 void sumBandsAVX2( float* output, const int channel, const int numSamples );
+    SJF_TARGET_AVX512 void calculateControlFramesAVX512( const int numSamples );
+    template< int INTERPOLATION, typename STORAGE >
+    SJF_TARGET_AVX512 void processDelaysAVX512( const int numChannels, const int numSamples );
+    SJF_TARGET_AVX512 void sumBandsAVX512( float* output, const int channel, const int numSamples );
+#endif
+    using controlProcessor = void ( Sjf_spectralProcessorAudioProcessor::* )( const int );
+    using outputProcessor = void ( Sjf_spectralProcessorAudioProcessor::* )( float*, const int, const int );
+    void reconstructBands( float* output, const int channel, const int numSamples );
+    void writeAuxOutputs( juce::AudioBuffer< float >& buffer, const int startSample, const int numSamples, const int numChannels );
+    void updateAuxOutputs();
+    void updateSidechain();
+    static int getAuxBus( const int routing, const int band );
+    static BusesProperties createBusesProperties();
+#if JUCE_DEBUG
+    void checkForBadValues( const juce::AudioBuffer< float >& buffer, const int numChannels );
+#endif
     
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 private:
@@ -155,18 +338,131 @@ private:
     { 100 , 150, 250, 350, 500, 630, 800, 1000, 1300, 1600, 2000, 2600, 3500, 5000, 8000, 10000 };
     //    { 1000 };
     
-    bool m_parametersChangedFlag = false, m_editorOpenFlag = false;
-    
-    std::array< std::array < sjf_biquadCascade< float >, NUM_BANDS >, 2 > m_filters;
-    std::array< sjf_lfo, NUM_BANDS > m_lfos, m_delayLfos;
-    std::array< std::array< sjf_delayLine< float >, NUM_BANDS >, 2 > m_delayLines;
-    
+    std::atomic< juce::uint32 > m_changedParameterGroups { 0 };
+    std::atomic< bool > m_editorOpenFlag { false };
+    
+    // a configured cascade for every [ rate mode ][ design ][ order ][ band ], set up front so changing design or order
+    // on the audio thread is just a copy. Tables never change once built, so every instance at the same sample rate
+    // and band layout shares one
+    using filterTableCache = sjf_sharedCache< std::pair< double, std::array< int, NUM_BANDS > >, filterTable >;
+    filterTableCache::pointer m_filterTable;
+    const sjf_bandFilter* m_bandDesigns = nullptr;
+    sjf_cascadeKernels::kernel m_filterKernel = nullptr;
+    int m_filterDesign = 0, m_filterOrder = 0;
+    
+    int m_kernelLevel = sjf_cpuDispatch::baseline;
+    // isNonRealtime() as of the last prepareToPlay, the profile never changes in between
+    bool m_renderQuality = false;
+    // steps the realtime settings down when blocks keep getting close to their deadline, m_qualityLevel is its level for this block
+    sjf_qualityGovernor m_governor;
+    int m_qualityLevel = sjf_qualityGovernor::full;
+    controlProcessor m_controlProcessor = &Sjf_spectralProcessorAudioProcessor::calculateControlFramesBaseline;
+    outputProcessor m_sumProcessor = &Sjf_spectralProcessorAudioProcessor::sumBandsBaseline;
+    std::array< std::array< sjf_bandFilter, NUM_BANDS >, 2 > m_filters;
+    
+    // with no lfos, delays, dynamics or vocoder running the bands and the dc filter are linear and time invariant, so the whole chain
+    // is swapped for one convolution with its impulse response. It is built on the message thread and only used if it times
+    // cheaper than the bands there. The hand over is exact either way:
+    // the side that stops is fed silence and rings out for the kernel's length while the other side takes the input
+    static constexpr double MAX_STATIC_KERNEL_SECONDS = 1.0;
+    std::unique_ptr< staticKernel > m_staticKernel;
+    staticSpec m_staticRequest;
+    bool m_staticRequested = false, m_staticInput = false, m_gainsSettled = false;
+    // left for the timer, which resizes the delay lines or builds the static kernel on the message thread
+    std::atomic< bool > m_delayLinesRequested { false }, m_staticKernelRequested { false };
+    int m_chainTailSamples = 0, m_staticTailSamples = 0;
+    std::array< std::vector< float >, 2 > m_staticFrames;
+    std::vector< float > m_silence;
+    
+    // dual mono, while both channels get the same input and the same modulation only the first is processed and copied to the second.
+    // The second's state is left behind and caught up from the first when they diverge ( apart from the delay lines, which are too big
+    // to copy so every write is mirrored ). Channels that have had different input aren't linked until the difference has rung out
+    bool m_channelsLinked = false;
+    juce::int64 m_identicalSamples = 0;
+    
+    std::array< sjf_lfo, NUM_BANDS > m_lfos;
+    // delay time modulation, one phase per band, see calculateControlFrames
+    sjf_phasorBank< NUM_BANDS > m_delayLfos;
+    sjf_lpf< float > m_delayModDepthSmoother, m_delayModSpreadSmoother;
+    // compressor / expander on the band frames, its envelopes can also move the lfo depth or duck the feedback
+    sjf_bandDynamics< NUM_BANDS > m_bandDynamics;
+    
+    // vocoder, the sidechain is split with the host rate filters for the current design and its band envelopes scale the main bands
+    static constexpr float VOCODER_ATTACK_MS = 2.0f, VOCODER_RELEASE_MS = 30.0f;
+    const sjf_bandFilter* m_sidechainDesigns = nullptr;
+    std::array< std::array< sjf_bandFilter, NUM_BANDS >, 2 > m_sidechainFilters;
+    sjf_bandDynamics< NUM_BANDS > m_vocoderEnvelopes;
+    int m_sidechainFirstChannel = 0, m_sidechainNumChannels = 0;
+    bool m_vocoderActive = false;
+    std::array< sjf_bandDelay< 2 >, NUM_BANDS > m_delays;
+    sjf_feedbackMatrix< NUM_BANDS > m_feedbackMatrix;
+    sjf_delayArena m_delayArena;
+    // format the arena was last prepared for, only changed with the callback lock held.
+    // Only bands with their delay switched on get any memory, shared out from the delayMemory budget
+    int m_delayStorage = float32Storage;
+    
+    // multirate mode, each band runs at sampleRate / 2^m_bandLevels[ b ] and only ticks when ( hostSample & m_bandTickMasks[ b ] ) == 0
+    std::array< sjf_multirateTree< MAX_MULTIRATE_LEVELS >, 2 > m_multirateTrees;
+    // output of the tree for every sample of the block, frames of MAX_MULTIRATE_LEVELS + 1
+    std::array< std::vector< float >, 2 > m_levelFrames;
+    std::array< int, NUM_BANDS > m_bandLevels {}, m_bandTickMasks {};
+    int m_hostSampleCount = 0;
+    bool m_multirateActive = false;
+    
+    
+    // aux output buses, band b is added to the bus getAuxBus picks for it ( buses that are switched off have no channels )
+    struct auxOutput { int firstChannel = 0, numChannels = 0; };
+    std::array< auxOutput, NUM_BANDS > m_auxOutputs {};
+    std::atomic< bool > m_hasAuxOutputs { false };
     
     std::array< sjf_lpf< float >, NUM_BANDS > m_gainSmoother, m_delaySmoother, m_fbSmoother, m_delayWetSmoother, m_delayDrySmoother, m_lfoSmoother;
     std::array< sjf_lpf< float >, 2 > dcFilter;
     
-    std::array< bool, NUM_BANDS > m_polarites, m_delaysOnOff, m_lfosOnOff;
+    // the delay time fluctuations are redrawn every JITTER_INTERVAL samples, whatever size the host's blocks are
+    static constexpr int JITTER_INTERVAL = 512;
+    juce::Random m_random;
+    std::array< float, NUM_BANDS > m_delayJitter {};
+    int m_samplesUntilJitter = 0;
+    
+    sjf_silenceDetector m_silenceDetector;
+    std::atomic< double > m_tailLengthSeconds { 0.0 };
+    std::array< std::atomic< float >, NUM_BANDS > m_delayLimitSeconds {};
+    
+    // targets calculated once per block and smoothed per sample in calculateControlFrames
+    struct blockTargets
+    {
+        std::array< float, NUM_BANDS > lfoDepth, gain, delayTime, feedback, delayWet, delayDry, delayModScale;
+        float delayModDepth = 0.0f, delayModSpread = 0.0f;
+        std::array< bool, NUM_BANDS > lfoOn, delayOn;
+        // false if nothing can hear the band: not routed to the main output, no aux buses and no feedback mixing
+        std::array< bool, NUM_BANDS > bandHeard;
+        int bandStart = 0, bandIncrement = 1;
+    };
+    blockTargets m_targets;
+    
+    // scratch buffers for each stage, stored as frames of NUM_BANDS samples
+    int m_maxBlockSize = 0;
+    double m_preparedSampleRate = 0.0;
+    std::vector< float > m_gainFrames, m_delayTimeFrames, m_feedbackFrames, m_delayWetFrames, m_delayDryFrames, m_envelopeFrames;
+    std::array< std::vector< float >, 2 > m_bandFrames;
+    // added to m_delayTimeFrames, separate for each channel
+    std::array< std::vector< float >, 2 > m_delayModFrames;
+    // split sidechain, its envelopes and a frame of 1s for the filter kernel's gain
+    std::array< std::vector< float >, 2 > m_sidechainFrames;
+    std::vector< float > m_vocoderFrames, m_unityFrames;
+    
+    std::atomic< bool > m_metricsEnabled { false };
+    bool m_collectMetrics = false;
+    blockMetrics m_metrics;
+    // channel samples the band metrics were summed over this block
+    int m_measuredSamples = 0;
+    sjf_metricsFifo< blockMetrics, 32 > m_metricsFifo;
+    
+    sjf_analyserFifo m_analyserFifo;
+    
+    std::array< bool, NUM_BANDS > m_polarites {}, m_delaysOnOff {}, m_lfosOnOff {};
     std::array< float, NUM_BANDS > m_bandGains, m_lfoRates, m_lfoDepths, m_lfoOffsets, m_delayTimes, m_feedbacks, m_delayMix;
+    bandChanges m_bandChanges;
     
     std::array< std::array< float, NUM_BANDS >, 4 > m_bandGainsPresets, m_lfoRatesPresets, m_lfoDepthsPresets, m_lfoOffsetsPresets, m_delayTimesPresets, m_feedbacksPresets, m_delayMixPresets;
     
@@ -180,8 +476,39 @@ private:
     std::atomic<float>* bandsParameter = nullptr;
     std::atomic<float>* filterDesignParameter = nullptr;
     std::atomic<float>* filterOrderParameter = nullptr;
+    std::atomic<float>* delayInterpolationParameter = nullptr;
+    std::atomic<float>* delayStorageParameter = nullptr;
+    std::atomic<float>* maxDelayTimeParameter = nullptr;
+    std::atomic<float>* delayMemoryParameter = nullptr;
+    std::atomic<float>* multirateParameter = nullptr;
+    std::atomic<float>* auxRoutingParameter = nullptr;
+    std::atomic<float>* feedbackMatrixParameter = nullptr;
+    std::atomic<float>* delayModRateParameter = nullptr;
+    std::atomic<float>* delayModDepthParameter = nullptr;
+    std::atomic<float>* delayModSpreadParameter = nullptr;
+    std::atomic<float>* dynamicsModeParameter = nullptr;
+    std::atomic<float>* dynamicsDetectorParameter = nullptr;
+    std::atomic<float>* dynamicsThresholdParameter = nullptr;
+    std::atomic<float>* dynamicsRatioParameter = nullptr;
+    std::atomic<float>* dynamicsAttackParameter = nullptr;
+    std::atomic<float>* dynamicsReleaseParameter = nullptr;
+    std::atomic<float>* envelopeTargetParameter = nullptr;
+    std::atomic<float>* envelopeAmountParameter = nullptr;
+    std::atomic<float>* vocoderParameter = nullptr;
+    std::atomic<float>* vocoderSensitivityParameter = nullptr;
+    std::atomic<float>* governorParameter = nullptr;
     std::atomic<float>* xParameter = nullptr;
     std::atomic<float>* yParameter = nullptr;
+    std::array< juce::RangedAudioParameter*, 2 > xyParameters {};
+    // pad position the band settings were last interpolated for
+    std::array< float, 2 > m_interpolatedXY { -1.0f, -1.0f };
+    // set from midi on the audio thread and handed to the message thread to update the parameters, -1 when nothing is waiting.
+    // Polled by the timer for the xy pad and by the editor for the preset
+    std::array< std::atomic< float >, 2 > m_midiXY { -1.0f, -1.0f };
+    std::atomic< int > m_midiPreset { -1 };
+    
+    // midi mapping, cc 16 / 17 move the xy pad, cc 20 - 35 and notes 36 - 51 set the band gains, program changes 0 - 3 recall the presets
+    static constexpr int MIDI_X_CC = 16, MIDI_Y_CC = 17, MIDI_FIRST_BAND_GAIN_CC = 20, MIDI_FIRST_BAND_NOTE = 36;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Sjf_spectralProcessorAudioProcessor)
 };
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    sjf_bandChanges.h
+
+    Hands per band settings made on the message thread ( the editor, preset
+    recalls and state loads ) over to the audio thread, which is the only
+    thing that writes the arrays the processing reads. Only the latest
+    change to each value is kept, so nothing piles up while the host isn't
+    calling processBlock, and the audio thread never waits for the message
+    thread, if it is part way through a change the changes wait a block
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template< int N >
+class sjf_bandChanges
+{
+    static_assert( N <= 32, "the bands changed in each field are kept as a 32 bit mask" );
+public:
+    // every per band setting, in the same order as the processor's parameter groups. Bools are stored as 0 / 1
+    enum field { bandGain, polarity, lfoOn, lfoDepth, lfoRate, lfoOffset, delayOn, delayTime, feedback, delayMix, numFields };
+    //==============================================================================
+    // message thread
+    void set( const int f, const int band, const float value )
+    {
+        const juce::SpinLock::ScopedLockType lock( m_lock );
+        m_values[ f ][ band ] = value;
+        m_changed[ f ] |= 1u << band;
+        m_hasChanges = true;
+    }
+    //==============================================================================
+    // message thread, returns true and the value if there is a change the audio thread hasn't applied yet
+    bool get( const int f, const int band, float& value ) const
+    {
+        const juce::SpinLock::ScopedLockType lock( m_lock );
+        if ( ( m_changed[ f ] & ( 1u << band ) ) == 0 ) { return false; }
+        value = m_values[ f ][ band ];
+        return true;
+    }
+    //==============================================================================
+    // audio thread, calls applyChange( field, band, value ) for every waiting change and then clears them.
+    // Returns straight away if the message thread holds the lock
+    template< typename function >
+    void apply( function&& applyChange )
+    {
+        if ( !m_hasChanges.load() ) { return; }
+        const juce::SpinLock::ScopedTryLockType lock( m_lock );
+        if ( !lock.isLocked() ) { return; }
+        for ( int f = 0; f < numFields; f++ )
+        {
+            for ( int b = 0; b < N; b++ ) { if ( m_changed[ f ] & ( 1u << b ) ) { applyChange( f, b, m_values[ f ][ b ] ); } }
+            m_changed[ f ] = 0;
+        }
+        m_hasChanges = false;
+    }
+    //==============================================================================
+private:
+    mutable juce::SpinLock m_lock;
+    std::array< std::array< float, N >, numFields > m_values {};
+    std::array< juce::uint32, numFields > m_changed {};
+    std::atomic< bool > m_hasChanges { false };
+};
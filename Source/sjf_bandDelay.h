@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    sjf_bandDelay.h
+
+    Multichannel fractional delay for a single band.
+    The delay time (and any interpolation coefficients) are calculated once
+    per sample, either shared by every channel or set for each channel on its
+    own when they're modulated differently. Buffers are a power of two long
+    so wrapping is just a mask. The buffers themselves are owned elsewhere
+    (see sjf_delayArena) and hold samples in any of the sjf_delayStorage
+    formats, which is chosen per read / write
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "sjf_delayStorage.h"
+
+template< int NUM_CHANNELS >
+class sjf_bandDelay
+{
+public:
+    // values match the "delayInterpolation" parameter
+    enum interpolation { linear = 1, allpass, cubic, lagrange };
+    //==============================================================================
+    // length each channel's buffer needs to be
+    static int getBufferSize( const int maxDelaySamples )
+    {
+        // extra room for the interpolation taps either side of the read position
+        return juce::nextPowerOfTwo( maxDelaySamples + 4 );
+    }
+    //==============================================================================
+    // buffers must be size samples of bytesPerSample long ( a power of two ) and outlive the delay
+    // a size of 0 leaves the delay without any memory, it must not be processed until it is given some
+    void initialise( const std::array< void*, NUM_CHANNELS >& buffers, const int size, const int bytesPerSample, const bool buffersAreClear = false )
+    {
+        jassert( size == 0 || juce::isPowerOfTwo( size ) );
+        m_buffers = size > 0 ? buffers : std::array< void*, NUM_CHANNELS > {};
+        m_size = size;
+        m_bytesPerSample = bytesPerSample;
+        m_mask = std::max( size - 1, 0 );
+        m_maxDelay = (float)std::max( size - 3, 1 );
+        m_writePosition = 0;
+        m_allpassState.fill( 0.0f );
+        m_isClear = buffersAreClear;
+        clear();
+    }
+    //==============================================================================
+    // carries on from where it left off with buffers that hold a copy of the current ones ( same size and format )
+    void moveBuffers( const std::array< void*, NUM_CHANNELS >& buffers )
+    {
+        jassert( m_size > 0 );
+        m_buffers = buffers;
+    }
+    //==============================================================================
+    bool hasBuffers() const { return m_size > 0; }
+    // longest delay in samples the buffers can hold
+    float getMaxDelay() const { return m_maxDelay; }
+    //==============================================================================
+    void clear()
+    {
+        if ( m_isClear ) { return; }
+        // every storage format is zero when all of its bytes are
+        for ( auto* buffer : m_buffers ) { if ( buffer != nullptr ) { std::memset( buffer, 0, (size_t)m_size * (size_t)m_bytesPerSample ); } }
+        m_allpassState.fill( 0.0f );
+        m_isClear = true;
+    }
+    //==============================================================================
+    // call once per sample before reading any channel
+    template< int INTERPOLATION >
+    void setDelayTimeSamps( const float delay )
+    {
+        for ( int channel = 0; channel < NUM_CHANNELS; channel++ ) { setDelayTimeSamps< INTERPOLATION >( channel, delay ); }
+    }
+    //==============================================================================
+    // call once per sample before reading that channel
+    template< int INTERPOLATION >
+    void setDelayTimeSamps( const int channel, float delay )
+    {
+        // cubic and lagrange read one sample newer than the integer delay, which hasn't been written yet at 1
+        static constexpr float minDelay = ( INTERPOLATION == cubic || INTERPOLATION == lagrange ) ? 2.0f : 1.0f;
+        delay = juce::jlimit( minDelay, m_maxDelay, delay );
+        auto delayInt = (int)delay;
+        m_fraction[ channel ] = delay - (float)delayInt;
+        m_readPosition[ channel ] = m_writePosition - delayInt;
+        if ( INTERPOLATION == allpass ) { m_allpassCoefficient[ channel ] = ( 1.0f - m_fraction[ channel ] ) / ( 1.0f + m_fraction[ channel ] ); }
+    }
+    //==============================================================================
+    template< int INTERPOLATION, typename STORAGE = sjf_float32Storage >
+    float read( const int channel )
+    {
+        auto* buffer = static_cast< const typename STORAGE::type* >( m_buffers[ channel ] );
+        auto tap = [ this, buffer ]( int position ) { return STORAGE::decode( buffer[ position & m_mask ] ); };
+        const auto readPosition = m_readPosition[ channel ];
+        const auto fraction = m_fraction[ channel ];
+        auto x0 = tap( readPosition );
+        auto x1 = tap( readPosition - 1 );
+        switch ( INTERPOLATION )
+        {
+            case linear:
+                return x0 + fraction * ( x1 - x0 );
+            case allpass:
+            {
+                auto out = x1 + m_allpassCoefficient[ channel ] * ( x0 - m_allpassState[ channel ] );
+                m_allpassState[ channel ] = out;
+                return out;
+            }
+            case cubic:
+            {
+                // hermite, taps from one newer to two older than the integer delay
+                auto xm1 = tap( readPosition + 1 );
+                auto x2 = tap( readPosition - 2 );
+                auto c1 = 0.5f * ( x1 - xm1 );
+                auto c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+                auto c3 = 0.5f * ( x2 - xm1 ) + 1.5f * ( x0 - x1 );
+                return ( ( c3 * fraction + c2 ) * fraction + c1 ) * fraction + x0;
+            }
+            case lagrange:
+            default:
+            {
+                // third order lagrange over the same four taps
+                auto xm1 = tap( readPosition + 1 );
+                auto x2 = tap( readPosition - 2 );
+                auto d = fraction;
+                auto dp1 = d + 1.0f, dm1 = d - 1.0f, dm2 = d - 2.0f;
+                return -( d * dm1 * dm2 / 6.0f ) * xm1
+                    + ( dp1 * dm1 * dm2 * 0.5f ) * x0
+                    - ( dp1 * d * dm2 * 0.5f ) * x1
+                    + ( dp1 * d * dm1 / 6.0f ) * x2;
+            }
+        }
+    }
+    //==============================================================================
+    template< typename STORAGE = sjf_float32Storage >
+    void write( const int channel, const float value )
+    {
+        static_cast< typename STORAGE::type* >( m_buffers[ channel ] )[ m_writePosition ] = STORAGE::encode( value );
+    }
+    //==============================================================================
+    // for when every channel carries the same signal and only the first has been read and written:
+    // copies its newest sample and interpolation state to the others so they can carry on from it
+    template< typename STORAGE = sjf_float32Storage >
+    void mirrorFirstChannel()
+    {
+        auto* first = static_cast< const typename STORAGE::type* >( m_buffers[ 0 ] );
+        for ( int channel = 1; channel < NUM_CHANNELS; channel++ )
+        {
+            static_cast< typename STORAGE::type* >( m_buffers[ channel ] )[ m_writePosition ] = first[ m_writePosition ];
+            m_allpassState[ channel ] = m_allpassState[ 0 ];
+        }
+    }
+    //==============================================================================
+    // call once per sample after every channel has been written
+    void advance()
+    {
+        m_writePosition = ( m_writePosition + 1 ) & m_mask;
+        m_isClear = false;
+    }
+    //==============================================================================
+private:
+    std::array< void*, NUM_CHANNELS > m_buffers {};
+    std::array< float, NUM_CHANNELS > m_allpassState {}, m_fraction {}, m_allpassCoefficient {};
+    std::array< int, NUM_CHANNELS > m_readPosition {};
+    int m_size = 0, m_bytesPerSample = sizeof( float ), m_writePosition = 0, m_mask = 0;
+    float m_maxDelay = 1.0f;
+    bool m_isClear = false;
+};
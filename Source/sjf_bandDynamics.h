@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    sjf_bandDynamics.h
+
+    Envelope followers and a compressor / expander for every band, run on the
+    band frames straight after the filters so the plugin's own band split is
+    reused. All N bands are worked out together for each sample (the channels
+    are linked), the log / exp of the gain computer are bit twiddling
+    approximations so the loop over bands vectorises (or the real thing when
+    accuracy matters more than speed). Decimated bands only update on the
+    samples they tick
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template< int N >
+class sjf_bandDynamics
+{
+public:
+    // values match the "dynamicsMode", "dynamicsDetector" and "envelopeTarget" parameters
+    enum mode { off = 1, compress, expand };
+    enum detector { peak = 1, rms };
+    enum target { noTarget = 1, lfoDepthTarget, feedbackTarget };
+    // deepest the expander will go, in log2 units ( about -60dB )
+    static constexpr float MAX_EXPANSION = -10.0f;
+    //==============================================================================
+    void reset() { m_envelopes.fill( 0.0f ); }
+    //==============================================================================
+    // call once per block, tickMasks are the bands' multirate tick masks ( all 0 at the host rate )
+    void setParameters( const int dynamicsMode, const int detectorType, const float thresholdDB, const float ratio, const float attackMs, const float releaseMs, const double sampleRate, const std::array< int, N >& tickMasks, const bool accurate = false )
+    {
+        m_accurate = accurate;
+        m_mode = dynamicsMode;
+        m_detector = detectorType;
+        // 20log10( x ) = 6.02 log2( x )
+        m_threshold = thresholdDB / 6.0206f;
+        m_ratio = std::max( ratio, 1.0f );
+        for ( int b = 0; b < N; b++ )
+        {
+            auto bandRate = sampleRate / (double)( tickMasks[ b ] + 1 );
+            m_attack[ b ] = (float)std::exp( -1.0 / ( std::max( attackMs, 0.01f ) * 0.001 * bandRate ) );
+            m_release[ b ] = (float)std::exp( -1.0 / ( std::max( releaseMs, 0.01f ) * 0.001 * bandRate ) );
+            m_tickMasks[ b ] = tickMasks[ b ];
+        }
+    }
+    //==============================================================================
+    // frames hold N bands per sample, right may be the same as left for mono.
+    // levels, if not null, gets each band's envelope relative to the threshold ( 0 - 1 ) for every sample
+    void process( float* left, float* right, const int numSamples, const int hostSample, float* levels )
+    {
+        if ( m_accurate ) { processMode< true >( left, right, numSamples, hostSample, levels ); }
+        else { processMode< false >( left, right, numSamples, hostSample, levels ); }
+    }
+    //==============================================================================
+    // the band's envelope relative to the threshold ( 0 - 1 ) at the end of the last block
+    float getLevel( const int band ) const { return fastExp2( std::min( getLog2Level( m_envelopes[ band ] ) * ( m_detector == rms ? 0.5f : 1.0f ) - m_threshold, 0.0f ) ); }
+    //==============================================================================
+    static float fastLog2( const float x )
+    {
+        juce::uint32 bits;
+        std::memcpy( &bits, &x, sizeof( bits ) );
+        auto exponent = (float)( (int)( ( bits >> 23 ) & 0xffu ) - 128 );
+        bits = ( bits & 0x7fffffu ) | 0x3f800000u;
+        float mantissa;
+        std::memcpy( &mantissa, &bits, sizeof( mantissa ) );
+        // 1 <= mantissa < 2, the polynomial is about log2( mantissa ) + 1 which the exponent's -128 makes up for
+        return exponent + ( -0.34484843f * mantissa + 2.02466578f ) * mantissa - 0.67487759f;
+    }
+    //==============================================================================
+    static float fastExp2( float x )
+    {
+        x = juce::jlimit( -126.0f, 126.0f, x );
+        auto whole = (int)x - ( x < 0.0f ? 1 : 0 );
+        auto fraction = x - (float)whole;
+        // 0 <= fraction < 1
+        auto power = 1.0f + fraction * ( 0.6958088f + fraction * ( 0.2262697f + fraction * 0.0782009f ) );
+        auto bits = (juce::uint32)( whole + 127 ) << 23;
+        float scale;
+        std::memcpy( &scale, &bits, sizeof( scale ) );
+        return scale * power;
+    }
+    //==============================================================================
+private:
+    static float getLog2Level( const float envelope ) { return fastLog2( envelope + 1.0e-12f ); }
+    
+    template< bool ACCURATE >
+    static float log2( const float x ) { return ACCURATE ? std::log2( x ) : fastLog2( x ); }
+    template< bool ACCURATE >
+    static float exp2( const float x ) { return ACCURATE ? std::exp2( x ) : fastExp2( x ); }
+
+    template< bool ACCURATE >
+    void processMode( float* left, float* right, const int numSamples, const int hostSample, float* levels )
+    {
+        switch ( m_mode )
+        {
+            case compress: return m_detector == rms ? processFrames< compress, rms, ACCURATE >( left, right, numSamples, hostSample, levels ) : processFrames< compress, peak, ACCURATE >( left, right, numSamples, hostSample, levels );
+            case expand: return m_detector == rms ? processFrames< expand, rms, ACCURATE >( left, right, numSamples, hostSample, levels ) : processFrames< expand, peak, ACCURATE >( left, right, numSamples, hostSample, levels );
+            default: return m_detector == rms ? processFrames< off, rms, ACCURATE >( left, right, numSamples, hostSample, levels ) : processFrames< off, peak, ACCURATE >( left, right, numSamples, hostSample, levels );
+        }
+    }
+
+    template< int MODE, int DETECTOR, bool ACCURATE >
+    void processFrames( float* left, float* right, const int numSamples, const int hostSample, float* levels )
+    {
+        // the rms envelope follows power, so its log is halved to get back to amplitude
+        static constexpr float levelScale = DETECTOR == rms ? 0.5f : 1.0f;
+        for ( int indexThroughBuffer = 0; indexThroughBuffer < numSamples; indexThroughBuffer++ )
+        {
+            auto frame = indexThroughBuffer * N;
+            auto sample = hostSample + indexThroughBuffer;
+            float* l = left + frame;
+            float* r = right + frame;
+            for ( int b = 0; b < N; b++ )
+            {
+                auto x = DETECTOR == rms ? 0.5f * ( l[ b ] * l[ b ] + r[ b ] * r[ b ] ) : std::max( std::abs( l[ b ] ), std::abs( r[ b ] ) );
+                auto envelope = m_envelopes[ b ];
+                auto coefficient = x > envelope ? m_attack[ b ] : m_release[ b ];
+                auto followed = x + coefficient * ( envelope - x );
+                // decimated bands are zero between ticks, which would pull the envelope down
+                envelope = ( sample & m_tickMasks[ b ] ) == 0 ? followed : envelope;
+                m_envelopes[ b ] = envelope;
+                auto over = log2< ACCURATE >( envelope + 1.0e-12f ) * levelScale - m_threshold;
+                if ( MODE != off )
+                {
+                    auto gainChange = MODE == compress ? std::max( over, 0.0f ) * ( 1.0f / m_ratio - 1.0f ) : std::max( std::min( over, 0.0f ) * ( m_ratio - 1.0f ), MAX_EXPANSION );
+                    auto gain = exp2< ACCURATE >( gainChange );
+                    l[ b ] *= gain;
+                    // right is left for mono, don't apply it twice
+                    if ( right != left ) { r[ b ] *= gain; }
+                }
+                if ( levels != nullptr ) { levels[ frame + b ] = exp2< ACCURATE >( std::min( over, 0.0f ) ); }
+            }
+        }
+    }
+
+    std::array< float, N > m_envelopes {}, m_attack {}, m_release {};
+    std::array< int, N > m_tickMasks {};
+    int m_mode = off, m_detector = peak;
+    bool m_accurate = false;
+    float m_threshold = 0.0f, m_ratio = 1.0f;
+};
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    sjf_cascadeFilter.h
+
+    The band filters are sjf_audio's biquad cascades, set up exactly the way
+    the plugin always has, so every design and order sounds the same as it
+    did. A configured cascade is kept for every design, order and band, and
+    a filter is reset or switched by copying one in. The kernels run a whole
+    block of one band through its cascade, compiled for each instruction set
+    ( see sjf_cpuDispatch )
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../sjf_audio/sjf_biquadCascade.h"
+#include "sjf_cpuDispatch.h"
+
+using sjf_bandFilter = sjf_biquadCascade< float >;
+
+//==============================================================================
+class sjf_cascadeDesigner
+{
+public:
+    // values match the "filterDesign" and "filterOrder" parameters
+    static constexpr int FIRST_DESIGN = 1, NUM_DESIGNS = 3;
+    static constexpr int MIN_ORDER = 2, MAX_ORDER = 8;
+    //==============================================================================
+    // filterType is one of sjf_biquadCalculator's, the settings are made in the same order initialiseFilters always made them
+    static sjf_bandFilter calculate( const int filterType, const int filterDesign, const int order, const double frequency, const double sampleRate )
+    {
+        sjf_bandFilter filter;
+        filter.setFilterDesign( filterDesign );
+        filter.setNumOrders( order );
+        filter.initialise( sampleRate );
+        filter.setFilterType( filterType );
+        filter.setFrequency( frequency );
+        return filter;
+    }
+};
+
+//==============================================================================
+class sjf_cascadeKernels
+{
+public:
+    // input and gain / output are strided so bands can be read from and written straight into frames
+    using kernel = void (*)( const float* input, const int inputStride, const float* gain, float* output, const int outputStride, const int numSamples, sjf_bandFilter& filter );
+    //==============================================================================
+    static kernel get( const int level = sjf_cpuDispatch::baseline )
+    {
+        switch ( level )
+        {
+#if SJF_X86_DISPATCH
+            case sjf_cpuDispatch::avx512: return &processAVX512;
+            case sjf_cpuDispatch::avx2: return &processAVX2;
+#endif
+            default: return &process;
+        }
+    }
+    //==============================================================================
+private:
+    static void process( const float* input, const int inputStride, const float* gain, float* output, const int outputStride, const int numSamples, sjf_bandFilter& filter )
+    {
+        processBlock( input, inputStride, gain, output, outputStride, numSamples, filter );
+    }
+#if SJF_X86_DISPATCH
+    SJF_TARGET_AVX2 static void processAVX2( const float* input, const int inputStride, const float* gain, float* output, const int outputStride, const int numSamples, sjf_bandFilter& filter )
+    {
+        processBlock( input, inputStride, gain, output, outputStride, numSamples, filter );
+    }
+    SJF_TARGET_AVX512 static void processAVX512( const float* input, const int inputStride, const float* gain, float* output, const int outputStride, const int numSamples, sjf_bandFilter& filter )
+    {
+        processBlock( input, inputStride, gain, output, outputStride, numSamples, filter );
+    }
+#endif
+    //==============================================================================
+    static SJF_FORCE_INLINE void processBlock( const float* input, const int inputStride, const float* gain, float* output, const int outputStride, const int numSamples, sjf_bandFilter& filter )
+    {
+        for ( int i = 0; i < numSamples; i++ ) { output[ i * outputStride ] = filter.filterInput( input[ i * inputStride ] ) * gain[ i * outputStride ]; }
+    }
+};
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    sjf_cpuDispatch.h
+
+    Picks which instruction set the hot kernels run with. The kernels are
+    written once as force inlined bodies and wrapped for each level, the
+    wrappers above baseline are compiled with their own target attribute so
+    the rest of the plugin still runs on anything. The level is detected
+    from cpuid and can be lowered for testing, either with setOverride or
+    the SJF_SPECTRAL_ISA environment variable (baseline, sse2, neon, avx2,
+    avx512)
+
+    Fma is deliberately left out of the targets, and the projects build
+    with -ffp-contract=off, so a multiply and add are never fused on one
+    machine and left apart on another. Built without fast math, as the
+    renderer is, every level gives the same output as the baseline
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// per function targets need gcc / clang on x86, everywhere else only the baseline ( sse2 on x86_64, neon on arm64 ) is built
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+ #define SJF_X86_DISPATCH 1
+ #define SJF_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+ #define SJF_TARGET_AVX512 __attribute__(( target( "avx512f,avx512vl,avx512bw,avx512dq,avx2" ) ))
+#else
+ #define SJF_X86_DISPATCH 0
+#endif
+
+#if defined( _MSC_VER )
+ #define SJF_FORCE_INLINE __forceinline
+#else
+ #define SJF_FORCE_INLINE inline __attribute__(( always_inline ))
+#endif
+
+class sjf_cpuDispatch
+{
+public:
+    enum level { baseline, avx2, avx512 };
+    //==============================================================================
+    // the level the kernels should use, never higher than the cpu supports
+    static int getLevel()
+    {
+        auto forced = getOverride().load();
+        return forced < 0 ? getDetectedLevel() : std::min( forced, getDetectedLevel() );
+    }
+    //==============================================================================
+    // -1 goes back to the detected level, only picked up by instances prepared after the change
+    static void setOverride( const int levelToUse ) { getOverride() = levelToUse; }
+    //==============================================================================
+    static int getDetectedLevel()
+    {
+        static const int detected = detectLevel();
+        return detected;
+    }
+    //==============================================================================
+    static juce::String getLevelName( const int levelToName )
+    {
+        switch ( levelToName )
+        {
+            case avx2: return "avx2";
+            case avx512: return "avx512";
+            default:
+#if JUCE_ARM
+                return "neon";
+#elif JUCE_INTEL
+                return "sse2";
+#else
+                return "generic";
+#endif
+        }
+    }
+    //==============================================================================
+private:
+    static int detectLevel()
+    {
+#if SJF_X86_DISPATCH
+        if ( juce::SystemStats::hasAVX512F() && juce::SystemStats::hasAVX512VL() && juce::SystemStats::hasAVX512BW() && juce::SystemStats::hasAVX512DQ() && juce::SystemStats::hasFMA3() ) { return avx512; }
+        if ( juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3() ) { return avx2; }
+#endif
+        return baseline;
+    }
+    //==============================================================================
+    static std::atomic< int >& getOverride()
+    {
+        static std::atomic< int > forced { parseLevel( juce::SystemStats::getEnvironmentVariable( "SJF_SPECTRAL_ISA", {} ).trim().toLowerCase() ) };
+        return forced;
+    }
+    //==============================================================================
+    static int parseLevel( const juce::String& name )
+    {
+        if ( name == "avx512" ) { return avx512; }
+        if ( name == "avx2" ) { return avx2; }
+        if ( name == "baseline" || name == "sse2" || name == "neon" ) { return baseline; }
+        return -1;
+    }
+};
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    sjf_delayArena.h
+
+    One contiguous, cache line aligned block of memory shared by every delay
+    line. Lines are views into the block and can all be different lengths
+    (zero length lines get no memory at all). It is only reallocated when the
+    layout changes, new memory always starts out zeroed
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class sjf_delayArena
+{
+public:
+    static constexpr size_t ALIGNMENT = 64;
+    //==============================================================================
+    // true if prepare would keep the current memory
+    bool matches( const std::vector< int >& samplesPerLine, const int bytesPerSample ) const
+    {
+        return samplesPerLine == m_samplesPerLine && bytesPerSample == m_bytesPerSample;
+    }
+    //==============================================================================
+    // allocates, so not for the audio thread. Returns true if the memory had to be (re)allocated,
+    // if not the old contents are left as they are
+    bool prepare( const std::vector< int >& samplesPerLine, const int bytesPerSample )
+    {
+        jassert( bytesPerSample > 0 );
+        if ( matches( samplesPerLine, bytesPerSample ) ) { return false; }
+        m_samplesPerLine = samplesPerLine;
+        m_bytesPerSample = bytesPerSample;
+        m_offsets.resize( samplesPerLine.size() );
+        size_t total = 0;
+        for ( size_t i = 0; i < samplesPerLine.size(); i++ )
+        {
+            m_offsets[ i ] = total;
+            total += alignUp( (size_t)samplesPerLine[ i ] * (size_t)bytesPerSample );
+        }
+        m_totalBytes = total;
+        m_memory.reset( total > 0 ? new char[ total + ALIGNMENT ]() : nullptr );
+        auto address = reinterpret_cast< std::uintptr_t >( m_memory.get() );
+        m_alignedStart = m_memory == nullptr ? nullptr : m_memory.get() + ( alignUp( address ) - address );
+        return true;
+    }
+    //==============================================================================
+    template< typename T >
+    T* getLine( const int index ) const
+    {
+        jassert( index >= 0 && index < getNumLines() );
+        if ( m_samplesPerLine[ (size_t)index ] == 0 ) { return nullptr; }
+        return reinterpret_cast< T* >( m_alignedStart + m_offsets[ (size_t)index ] );
+    }
+    //==============================================================================
+    // copies a line of the same length and format from another arena, for keeping what it holds across a reallocation
+    void copyLine( const sjf_delayArena& other, const int index )
+    {
+        jassert( getLineSize( index ) == other.getLineSize( index ) && m_bytesPerSample == other.m_bytesPerSample );
+        if ( getLineSize( index ) == 0 ) { return; }
+        std::memcpy( getLine< char >( index ), other.getLine< char >( index ), (size_t)getLineSize( index ) * (size_t)m_bytesPerSample );
+    }
+    //==============================================================================
+    int getNumLines() const { return (int)m_samplesPerLine.size(); }
+    int getLineSize( const int index ) const { return m_samplesPerLine[ (size_t)index ]; }
+    // bytes actually allocated, including alignment padding
+    size_t getFootprintBytes() const { return m_memory == nullptr ? 0 : m_totalBytes + ALIGNMENT; }
+    //==============================================================================
+private:
+    static size_t alignUp( const size_t x ) { return ( x + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 ); }
+
+    std::unique_ptr< char[] > m_memory;
+    char* m_alignedStart = nullptr;
+    std::vector< int > m_samplesPerLine;
+    std::vector< size_t > m_offsets;
+    size_t m_totalBytes = 0;
+    int m_bytesPerSample = 0;
+};
@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    sjf_delayStorage.h
+
+    Sample formats the band delays can be stored in. Each one converts to and
+    from float on every read / write, the reduced precision ones trade noise
+    for half (or three quarters) of the memory and bandwidth
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+struct sjf_float32Storage
+{
+    using type = float;
+    static float encode( const float x ) { return x; }
+    static float decode( const float x ) { return x; }
+};
+
+//==============================================================================
+// ieee 754 half precision, rounds to nearest even, clamps to the largest finite value instead of overflowing to inf
+struct sjf_float16Storage
+{
+    using type = juce::uint16;
+    static juce::uint16 encode( const float x )
+    {
+        juce::uint32 bits;
+        std::memcpy( &bits, &x, sizeof( bits ) );
+        auto sign = ( bits >> 16 ) & 0x8000u;
+        auto exponent = (int)( ( bits >> 23 ) & 0xffu ) - 127 + 15;
+        auto mantissa = bits & 0x7fffffu;
+        if ( ( ( bits >> 23 ) & 0xffu ) == 0xffu ) { return (juce::uint16)( mantissa != 0 ? 0 : sign | 0x7bffu ); } // nan to silence, inf to max
+        if ( exponent >= 31 ) { return (juce::uint16)( sign | 0x7bffu ); }
+        if ( exponent <= 0 )
+        {
+            // subnormal half
+            if ( exponent < -10 ) { return (juce::uint16)sign; }
+            mantissa |= 0x800000u;
+            auto shift = (juce::uint32)( 14 - exponent );
+            auto half = mantissa >> shift;
+            auto remainder = mantissa & ( ( 1u << shift ) - 1u );
+            auto halfway = 1u << ( shift - 1u );
+            if ( remainder > halfway || ( remainder == halfway && ( half & 1u ) ) ) { half++; }
+            return (juce::uint16)( sign | half );
+        }
+        auto half = ( (juce::uint32)exponent << 10 ) | ( mantissa >> 13 );
+        auto remainder = mantissa & 0x1fffu;
+        if ( remainder > 0x1000u || ( remainder == 0x1000u && ( half & 1u ) ) ) { half++; }
+        if ( half >= 0x7c00u ) { half = 0x7bffu; }
+        return (juce::uint16)( sign | half );
+    }
+    static float decode( const juce::uint16 h )
+    {
+        auto sign = (juce::uint32)( h & 0x8000u ) << 16;
+        auto exponent = ( h >> 10 ) & 0x1fu;
+        auto mantissa = (juce::uint32)( h & 0x3ffu );
+        if ( exponent == 0 )
+        {
+            auto value = (float)mantissa * 5.9604644775390625e-8f; // 2^-24
+            return sign ? -value : value;
+        }
+        auto bits = sign | ( ( exponent + 112u ) << 23 ) | ( mantissa << 13 );
+        float x;
+        std::memcpy( &x, &bits, sizeof( x ) );
+        return x;
+    }
+};
+
+//==============================================================================
+// top half of a float, same range as float but only 8 bits of mantissa
+struct sjf_bfloat16Storage
+{
+    using type = juce::uint16;
+    static juce::uint16 encode( const float x )
+    {
+        juce::uint32 bits;
+        std::memcpy( &bits, &x, sizeof( bits ) );
+        if ( ( bits & 0x7fffffffu ) > 0x7f800000u ) { return 0; } // nan to silence
+        bits += 0x7fffu + ( ( bits >> 16 ) & 1u );
+        return (juce::uint16)( bits >> 16 );
+    }
+    static float decode( const juce::uint16 b )
+    {
+        auto bits = (juce::uint32)b << 16;
+        float x;
+        std::memcpy( &x, &bits, sizeof( x ) );
+        return x;
+    }
+};
+
+//==============================================================================
+// packed 24 bit fixed point, +/-HEADROOM is full scale since the feedback path can go well over 1
+struct sjf_int24Storage
+{
+    struct type { juce::uint8 bytes[ 3 ]; };
+    static constexpr float HEADROOM = 8.0f;
+    static type encode( const float x )
+    {
+        static constexpr float scale = 8388607.0f / HEADROOM;
+        auto clipped = juce::jlimit( -HEADROOM, HEADROOM, x );
+        auto i = (juce::int32)std::lrint( clipped * scale );
+        return { { (juce::uint8)( i & 0xff ), (juce::uint8)( ( i >> 8 ) & 0xff ), (juce::uint8)( ( i >> 16 ) & 0xff ) } };
+    }
+    static float decode( const type t )
+    {
+        static constexpr float scale = HEADROOM / 8388607.0f;
+        // shift up to the top of an int32 and back down to sign extend
+        auto i = (juce::int32)( ( (juce::uint32)t.bytes[ 0 ] << 8 ) | ( (juce::uint32)t.bytes[ 1 ] << 16 ) | ( (juce::uint32)t.bytes[ 2 ] << 24 ) ) >> 8;
+        return (float)i * scale;
+    }
+};
+static_assert( sizeof( sjf_int24Storage::type ) == 3, "int24 storage should be packed" );
+
+//==============================================================================
+// values match the "delayStorage" parameter
+enum sjf_delayStorageType { float32Storage = 1, float16Storage, bfloat16Storage, int24Storage };
+
+inline int sjf_delayStorageBytes( const int storageType )
+{
+    switch ( storageType )
+    {
+        case float16Storage: return sizeof( sjf_float16Storage::type );
+        case bfloat16Storage: return sizeof( sjf_bfloat16Storage::type );
+        case int24Storage: return sizeof( sjf_int24Storage::type );
+        default: return sizeof( sjf_float32Storage::type );
+    }
+}
+
+//==============================================================================
+// error added by one write/read round trip, in dB relative to full scale (1.0)
+struct sjf_storageNoiseFloor
+{
+    double fullScaleDB, quietDB; // for a 0dBFS and a -60dBFS sine
+};
+
+template< typename STORAGE >
+sjf_storageNoiseFloor sjf_measureStorageNoiseFloor()
+{
+    auto measure = []( double amplitude )
+    {
+        static constexpr int numSamples = 8192;
+        double errorSquared = 0.0;
+        for ( int i = 0; i < numSamples; i++ )
+        {
+            auto x = (float)( amplitude * std::sin( juce::MathConstants< double >::twoPi * 997.0 * i / 44100.0 ) );
+            auto error = (double)STORAGE::decode( STORAGE::encode( x ) ) - (double)x;
+            errorSquared += error * error;
+        }
+        return juce::Decibels::gainToDecibels( std::sqrt( errorSquared / numSamples ), -300.0 );
+    };
+    return { measure( 1.0 ), measure( 0.001 ) };
+}
+
+inline sjf_storageNoiseFloor sjf_measureStorageNoiseFloor( const int storageType )
+{
+    switch ( storageType )
+    {
+        case float16Storage: return sjf_measureStorageNoiseFloor< sjf_float16Storage >();
+        case bfloat16Storage: return sjf_measureStorageNoiseFloor< sjf_bfloat16Storage >();
+        case int24Storage: return sjf_measureStorageNoiseFloor< sjf_int24Storage >();
+        default: return sjf_measureStorageNoiseFloor< sjf_float32Storage >();
+    }
+}
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    sjf_feedbackMatrix.h
+
+    Mixes the feedback of every band's delay into every other band, turning
+    the per band delays into a feedback delay network. Householder and
+    Hadamard are orthogonal so they don't add or remove energy, they're done
+    as fast transforms ( O(N) and O(N log N) ). A custom matrix is a plain
+    matrix-vector product, it is scaled down when it's set if it has any gain
+    so the network can't run away
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template< int N >
+class sjf_feedbackMatrix
+{
+    static_assert( N > 0 && ( N & ( N - 1 ) ) == 0, "the hadamard transform needs a power of two size" );
+public:
+    // values match the "feedbackMatrix" parameter, independent leaves every band feeding back into itself
+    enum type { independent = 1, householder, hadamard, custom };
+    using matrix = std::array< float, N * N >;
+    //==============================================================================
+    sjf_feedbackMatrix() { m_custom = getIdentity(); }
+    //==============================================================================
+    static matrix getIdentity()
+    {
+        matrix identity {};
+        for ( int i = 0; i < N; i++ ) { identity[ i * N + i ] = 1.0f; }
+        return identity;
+    }
+    //==============================================================================
+    // row major, output i is the sum of m[ i * N + j ] * input j.
+    // Leaves the matrix as it is if any value isn't finite, otherwise it is scaled down to a gain of 1 if it's louder
+    bool setCustom( const matrix& m )
+    {
+        for ( auto x : m ) { if ( !std::isfinite( x ) ) { return false; } }
+        m_custom = limitGain( m );
+        return true;
+    }
+    const matrix& getCustom() const { return m_custom; }
+    //==============================================================================
+    // the most the matrix can amplify any input ( its spectral norm ), by power iteration on m^T m
+    static float getGain( const matrix& m )
+    {
+        std::array< double, N > v, w;
+        // uneven start so it can't be orthogonal to the loudest direction of a symmetric matrix
+        for ( int i = 0; i < N; i++ ) { v[ i ] = 1.0 + 0.1 * i; }
+        double gainSquared = 0.0;
+        for ( int iteration = 0; iteration < 100; iteration++ )
+        {
+            std::array< double, N > mv {};
+            for ( int i = 0; i < N; i++ ) { for ( int j = 0; j < N; j++ ) { mv[ i ] += m[ i * N + j ] * v[ j ]; } }
+            w.fill( 0.0 );
+            for ( int i = 0; i < N; i++ ) { for ( int j = 0; j < N; j++ ) { w[ j ] += m[ i * N + j ] * mv[ i ]; } }
+            double length = 0.0;
+            for ( auto x : w ) { length += x * x; }
+            length = std::sqrt( length );
+            if ( length <= 0.0 ) { return 0.0f; }
+            double vLength = 0.0;
+            for ( auto x : v ) { vLength += x * x; }
+            gainSquared = length / std::sqrt( vLength );
+            for ( int i = 0; i < N; i++ ) { v[ i ] = w[ i ] / length; }
+        }
+        return (float)std::sqrt( gainSquared );
+    }
+    //==============================================================================
+    // orthogonal matrices (gain 1) come back untouched, anything louder is scaled down to a gain of 1
+    static matrix limitGain( matrix m )
+    {
+        auto gain = getGain( m );
+        if ( gain <= 1.0f + 1.0e-4f ) { return m; }
+        for ( auto& x : m ) { x /= gain; }
+        return m;
+    }
+    //==============================================================================
+    // mixes v in place
+    void process( float* v, const int matrixType ) const
+    {
+        switch ( matrixType )
+        {
+            case householder:
+            {
+                // I - 2/N * ones
+                float sum = 0.0f;
+                for ( int i = 0; i < N; i++ ) { sum += v[ i ]; }
+                sum *= 2.0f / (float)N;
+                for ( int i = 0; i < N; i++ ) { v[ i ] -= sum; }
+                break;
+            }
+            case hadamard:
+            {
+                // fast walsh hadamard transform, scaled to keep it orthogonal
+                for ( int half = 1; half < N; half *= 2 )
+                {
+                    for ( int i = 0; i < N; i += 2 * half )
+                    {
+                        for ( int j = i; j < i + half; j++ )
+                        {
+                            auto a = v[ j ], b = v[ j + half ];
+                            v[ j ] = a + b;
+                            v[ j + half ] = a - b;
+                        }
+                    }
+                }
+                static const float scale = 1.0f / std::sqrt( (float)N );
+                for ( int i = 0; i < N; i++ ) { v[ i ] *= scale; }
+                break;
+            }
+            case custom:
+            {
+                std::array< float, N > out {};
+                for ( int i = 0; i < N; i++ )
+                {
+                    for ( int j = 0; j < N; j++ ) { out[ i ] += m_custom[ i * N + j ] * v[ j ]; }
+                }
+                std::copy( out.begin(), out.end(), v );
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    //==============================================================================
+    juce::String toString() const
+    {
+        juce::StringArray values;
+        for ( auto x : m_custom ) { values.add( juce::String( x ) ); }
+        return values.joinIntoString( " " );
+    }
+    //==============================================================================
+    // leaves the matrix as it is unless the string holds all N * N values, limited the same way as setCustom
+    bool fromString( const juce::String& text )
+    {
+        auto values = juce::StringArray::fromTokens( text, " ", "" );
+        values.removeEmptyStrings();
+        if ( values.size() != N * N ) { return false; }
+        matrix m;
+        for ( int i = 0; i < N * N; i++ ) { m[ i ] = values[ i ].getFloatValue(); }
+        return setCustom( m );
+    }
+    //==============================================================================
+private:
+    matrix m_custom;
+};
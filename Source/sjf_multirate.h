@@ -0,0 +1,200 @@
+/*
+  ==============================================================================
+
+    sjf_multirate.h
+
+    Octave tree of halfband decimators / interpolators so that low bands can
+    be filtered, modulated and delayed at a fraction of the host rate.
+    Level l runs at sampleRate / 2^l and ticks on host samples that are a
+    multiple of 2^l. Each level's band sum is delayed to line up with the
+    decimate -> interpolate round trip through the levels below it
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// blackman windowed sinc halfband lowpass, every other tap is zero apart from the centre
+struct sjf_halfbandCoefficients
+{
+    static constexpr int NUM_TAPS = 31;
+    static constexpr int CENTRE = ( NUM_TAPS - 1 ) / 2;
+    static constexpr int NUM_EVEN_TAPS = ( NUM_TAPS + 1 ) / 2;
+    // delay of one decimate + interpolate round trip, in samples at the higher rate
+    static constexpr int ROUND_TRIP_LATENCY = NUM_TAPS - 1;
+
+    // the non-zero taps either side of the centre ( h[ 0 ], h[ 2 ], ... h[ NUM_TAPS - 1 ] )
+    static const std::array< float, NUM_EVEN_TAPS >& get()
+    {
+        static const auto coefficients = calculate();
+        return coefficients;
+    }
+
+private:
+    static std::array< float, NUM_EVEN_TAPS > calculate()
+    {
+        std::array< double, NUM_EVEN_TAPS > taps;
+        double sum = 0.0;
+        for ( int i = 0; i < NUM_EVEN_TAPS; i++ )
+        {
+            auto n = 2 * i;
+            auto x = juce::MathConstants< double >::pi * 0.5 * ( n - CENTRE );
+            auto window = 0.42 - 0.5 * std::cos( juce::MathConstants< double >::twoPi * n / ( NUM_TAPS - 1 ) ) + 0.08 * std::cos( 2.0 * juce::MathConstants< double >::twoPi * n / ( NUM_TAPS - 1 ) );
+            taps[ i ] = window * std::sin( x ) / x;
+            sum += taps[ i ];
+        }
+        // centre tap is 0.5, so the rest have to sum to 0.5 for unity gain at dc
+        std::array< float, NUM_EVEN_TAPS > coefficients;
+        for ( int i = 0; i < NUM_EVEN_TAPS; i++ ) { coefficients[ i ] = (float)( 0.5 * taps[ i ] / sum ); }
+        return coefficients;
+    }
+};
+
+//==============================================================================
+// push every sample at the higher rate, read output() on the samples that are kept
+class sjf_halfbandDecimator
+{
+    using coefficients = sjf_halfbandCoefficients;
+    static constexpr int MASK = 31;
+    static_assert( coefficients::NUM_TAPS <= MASK + 1, "history too short for the halfband" );
+public:
+    void reset() { m_history.fill( 0.0f ); m_position = 0; }
+
+    void push( const float x )
+    {
+        m_position = ( m_position + 1 ) & MASK;
+        m_history[ m_position ] = x;
+    }
+
+    float output() const
+    {
+        auto& h = coefficients::get();
+        float sum = 0.5f * m_history[ ( m_position - coefficients::CENTRE ) & MASK ];
+        for ( int i = 0; i < coefficients::NUM_EVEN_TAPS; i++ ) { sum += h[ i ] * m_history[ ( m_position - 2 * i ) & MASK ]; }
+        return sum;
+    }
+
+private:
+    std::array< float, MASK + 1 > m_history {};
+    int m_position = 0;
+};
+
+//==============================================================================
+// runs at the higher rate, only the non-zero taps of the zero stuffed input are calculated
+class sjf_halfbandInterpolator
+{
+    using coefficients = sjf_halfbandCoefficients;
+    static constexpr int MASK = 15;
+    static_assert( coefficients::NUM_EVEN_TAPS <= MASK + 1, "history too short for the halfband" );
+public:
+    void reset() { m_history.fill( 0.0f ); m_position = 0; }
+
+    // lowerRateTicked is true on the samples where the lower rate has a new input
+    float process( const bool lowerRateTicked, const float x )
+    {
+        if ( !lowerRateTicked ) { return m_history[ ( m_position - ( coefficients::CENTRE - 1 ) / 2 ) & MASK ]; }
+        m_position = ( m_position + 1 ) & MASK;
+        m_history[ m_position ] = x;
+        auto& h = coefficients::get();
+        float sum = 0.0f;
+        for ( int i = 0; i < coefficients::NUM_EVEN_TAPS; i++ ) { sum += h[ i ] * m_history[ ( m_position - i ) & MASK ]; }
+        // x2 to make up for the zero stuffing
+        return 2.0f * sum;
+    }
+
+private:
+    std::array< float, MASK + 1 > m_history {};
+    int m_position = 0;
+};
+
+//==============================================================================
+template< int MAX_LEVELS >
+class sjf_multirateTree
+{
+public:
+    //==============================================================================
+    static bool ticks( const int level, const int hostSample ) { return ( hostSample & ( ( 1 << level ) - 1 ) ) == 0; }
+
+    // delay added at the host rate by a tree numLevels deep
+    static int getLatencySamples( const int numLevels ) { return sjf_halfbandCoefficients::ROUND_TRIP_LATENCY * ( ( 1 << numLevels ) - 1 ); }
+    //==============================================================================
+    // not realtime safe, call from prepareToPlay or with processing suspended
+    void initialise( const int numLevels )
+    {
+        jassert( numLevels >= 0 && numLevels <= MAX_LEVELS );
+        m_numLevels = numLevels;
+        for ( int l = 0; l <= MAX_LEVELS; l++ )
+        {
+            auto length = l <= numLevels ? getLatencySamples( numLevels - l ) : 0;
+            m_compensation[ l ].assign( (size_t)length, 0.0f );
+        }
+        reset();
+    }
+    //==============================================================================
+    void reset()
+    {
+        for ( auto& d : m_decimators ) { d.reset(); }
+        for ( auto& i : m_interpolators ) { i.reset(); }
+        for ( auto& c : m_compensation ) { std::fill( c.begin(), c.end(), 0.0f ); }
+        m_compensationPosition.fill( 0 );
+    }
+    //==============================================================================
+    // takes over another tree's state, both must have been initialised with the same number of levels. Doesn't allocate
+    void copyStateFrom( const sjf_multirateTree& other )
+    {
+        jassert( other.m_numLevels == m_numLevels );
+        m_decimators = other.m_decimators;
+        m_interpolators = other.m_interpolators;
+        for ( int l = 0; l <= MAX_LEVELS; l++ ) { std::copy( other.m_compensation[ l ].begin(), other.m_compensation[ l ].end(), m_compensation[ l ].begin() ); }
+        m_compensationPosition = other.m_compensationPosition;
+    }
+    //==============================================================================
+    int getNumLevels() const { return m_numLevels; }
+    //==============================================================================
+    // writes the input at every level that ticks on this host sample, the rest are left untouched
+    void analyse( const float input, const int hostSample, float* levels )
+    {
+        levels[ 0 ] = input;
+        for ( int l = 0; l < m_numLevels; l++ )
+        {
+            m_decimators[ l ].push( levels[ l ] );
+            if ( !ticks( l + 1, hostSample ) ) { return; }
+            levels[ l + 1 ] = m_decimators[ l ].output();
+        }
+    }
+    //==============================================================================
+    // levelSums holds the sum of the bands at each level, only read on the levels that tick
+    float synthesise( const float* levelSums, const int hostSample )
+    {
+        float below = 0.0f;
+        for ( int l = m_numLevels; l >= 0; l-- )
+        {
+            if ( !ticks( l, hostSample ) ) { continue; }
+            auto out = compensate( l, levelSums[ l ] );
+            if ( l < m_numLevels ) { out += m_interpolators[ l ].process( ticks( l + 1, hostSample ), below ); }
+            below = out;
+        }
+        return below;
+    }
+    //==============================================================================
+private:
+    float compensate( const int level, const float x )
+    {
+        auto& line = m_compensation[ level ];
+        if ( line.empty() ) { return x; }
+        auto& position = m_compensationPosition[ level ];
+        auto out = line[ position ];
+        line[ position ] = x;
+        if ( ++position >= (int)line.size() ) { position = 0; }
+        return out;
+    }
+
+    int m_numLevels = 0;
+    std::array< sjf_halfbandDecimator, MAX_LEVELS > m_decimators;
+    std::array< sjf_halfbandInterpolator, MAX_LEVELS > m_interpolators;
+    std::array< std::vector< float >, MAX_LEVELS + 1 > m_compensation;
+    std::array< int, MAX_LEVELS + 1 > m_compensationPosition {};
+};
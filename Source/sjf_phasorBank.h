@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    sjf_phasorBank.h
+
+    A bank of N phase accumulators that are all advanced together, with a
+    cheap polynomial sine so that a whole bank of lfos can be worked out in
+    one loop the compiler can vectorise. Phases are in cycles ( 0 - 1 ) and
+    stay continuous when the rate changes
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template< int N >
+class sjf_phasorBank
+{
+public:
+    //==============================================================================
+    void setPhase( const int index, const float phase ) { m_phases[ index ] = wrap( phase ); }
+    void setRate( const int index, const float hz, const double sampleRate ) { m_increments[ index ] = (float)( hz / sampleRate ); }
+    //==============================================================================
+    // call once per sample
+    void advance()
+    {
+        for ( int i = 0; i < N; i++ ) { m_phases[ i ] = wrap( m_phases[ i ] + m_increments[ i ] ); }
+    }
+    //==============================================================================
+    const float* getPhases() const { return m_phases.data(); }
+    //==============================================================================
+    // any non-negative phase, wrapped back into 0 - 1
+    static float wrap( const float phase ) { return phase - (float)(int)phase; }
+    //==============================================================================
+    // sin( 2pi * phase ) for a phase in cycles, within about 0.001 and smooth enough to modulate a delay with
+    static float sine( const float phase )
+    {
+        static constexpr float pi = juce::MathConstants< float >::pi;
+        auto x = juce::MathConstants< float >::twoPi * ( wrap( phase + 0.5f ) - 0.5f ); // -pi to pi
+        auto y = ( 4.0f / pi ) * x - ( 4.0f / ( pi * pi ) ) * x * std::abs( x );
+        return 0.225f * ( y * std::abs( y ) - y ) + y;
+    }
+    //==============================================================================
+private:
+    std::array< float, N > m_phases {}, m_increments {};
+};
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    sjf_qualityGovernor.h
+
+    Watches how long each processBlock takes compared to the time the host
+    gives it ( numSamples / sampleRate ). After a sustained run of blocks
+    over the high water mark it steps down a quality level, and only steps
+    back up once the load has stayed under the low water mark for a good
+    while, so it doesn't flip back and forth between levels. The level can
+    be fixed with setOverride for testing
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class sjf_qualityGovernor
+{
+public:
+    // each level includes the savings of the ones before it
+    enum level { full = 0, skipInactiveBands, reducedOrder, minimal, numLevels };
+    //==============================================================================
+    void reset()
+    {
+        m_level.store( full );
+        m_overSeconds = m_underSeconds = 0.0;
+        m_load = 0.0;
+    }
+    //==============================================================================
+    int getLevel() const
+    {
+        auto forced = getOverride().load();
+        return forced < 0 ? m_level.load() : forced;
+    }
+    // smoothed fraction of the deadline used, 1 means the block only just made it
+    double getLoad() const { return m_load; }
+    //==============================================================================
+    // call at the end of every block the governor is active for, the new level applies from the next block
+    void update( const double blockSeconds, const double deadlineSeconds )
+    {
+        if ( deadlineSeconds <= 0.0 ) { return; }
+        // light smoothing so a single slow block ( page fault, ui redraw ) doesn't count as pressure
+        m_load += 0.5 * ( blockSeconds / deadlineSeconds - m_load );
+        auto currentLevel = m_level.load();
+        m_overSeconds = m_load > HIGH_WATER ? m_overSeconds + deadlineSeconds : 0.0;
+        m_underSeconds = m_load < LOW_WATER ? m_underSeconds + deadlineSeconds : 0.0;
+        if ( m_overSeconds >= DEGRADE_SECONDS && currentLevel < numLevels - 1 )
+        {
+            m_level.store( currentLevel + 1 );
+            m_overSeconds = m_underSeconds = 0.0;
+        }
+        else if ( m_underSeconds >= RECOVER_SECONDS && currentLevel > full )
+        {
+            m_level.store( currentLevel - 1 );
+            m_overSeconds = m_underSeconds = 0.0;
+        }
+    }
+    //==============================================================================
+    // holds every governed instance at one level so the tests can hear each of them, -1 goes back to timing the blocks
+    static void setOverride( const int levelToUse ) { getOverride() = levelToUse; }
+    //==============================================================================
+private:
+    static std::atomic< int >& getOverride()
+    {
+        static std::atomic< int > forced { -1 };
+        return forced;
+    }
+
+    static constexpr double HIGH_WATER = 0.75, LOW_WATER = 0.4;
+    // steps down quickly, back up slowly
+    static constexpr double DEGRADE_SECONDS = 0.1, RECOVER_SECONDS = 3.0;
+
+    std::atomic< int > m_level { full };
+    double m_overSeconds = 0.0, m_underSeconds = 0.0, m_load = 0.0;
+};
@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    sjf_sharedCache.h
+
+    Process wide cache of immutable values shared by every plugin instance.
+    A value is built the first time its key is asked for and freed once the
+    last instance holding it lets go. Locks and allocates, so it's for
+    prepareToPlay and the message thread, never the audio thread
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template< typename KEY, typename VALUE >
+class sjf_sharedCache
+{
+public:
+    using pointer = std::shared_ptr< const VALUE >;
+    //==============================================================================
+    // build is only called if no one is holding a value for key. It runs with the cache locked,
+    // so instances preparing at the same time wait for the first one instead of all building the same thing
+    template< typename BUILDER >
+    static pointer get( const KEY& key, BUILDER&& build )
+    {
+        auto& cache = getInstance();
+        const juce::ScopedLock lock( cache.m_lock );
+        // forget anything nobody is holding any more
+        for ( auto it = cache.m_values.begin(); it != cache.m_values.end(); )
+        {
+            if ( it->second.expired() ) { it = cache.m_values.erase( it ); }
+            else { ++it; }
+        }
+        auto& entry = cache.m_values[ key ];
+        if ( auto existing = entry.lock() ) { return existing; }
+        pointer value = std::make_shared< const VALUE >( build() );
+        entry = value;
+        return value;
+    }
+    //==============================================================================
+private:
+    static sjf_sharedCache& getInstance()
+    {
+        static sjf_sharedCache cache;
+        return cache;
+    }
+
+    juce::CriticalSection m_lock;
+    std::map< KEY, std::weak_ptr< const VALUE > > m_values;
+};
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    sjf_silenceDetector.h
+
+    Tracks whether the processor can stop running its band chain. It goes to
+    sleep once the input has been silent for longer than the current tail and
+    the output has decayed below a threshold, and wakes on any non-zero input
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class sjf_silenceDetector
+{
+public:
+    //==============================================================================
+    void initialise( double sampleRate )
+    {
+        m_sampleRate = sampleRate;
+        reset();
+    }
+    //==============================================================================
+    void reset()
+    {
+        m_silentSamples = 0;
+        m_isSleeping = false;
+    }
+    //==============================================================================
+    // number of silent input samples required before the chain can sleep
+    void setTailLengthSeconds( double tailSeconds )
+    {
+        m_tailSamples = (juce::int64)std::ceil( tailSeconds * m_sampleRate );
+    }
+    //==============================================================================
+    // any non-zero input sample counts as signal
+    static bool inputIsSilent( const juce::AudioBuffer< float >& buffer, int numChannels, int startSample, int numSamples )
+    {
+        for ( int c = 0; c < numChannels; c++ )
+        {
+            if ( buffer.getMagnitude( c, startSample, numSamples ) > 0.0f ) { return false; }
+        }
+        return true;
+    }
+    //==============================================================================
+    bool isSleeping() const { return m_isSleeping; }
+    //==============================================================================
+    void wake()
+    {
+        m_isSleeping = false;
+        m_silentSamples = 0;
+    }
+    //==============================================================================
+    // call after each processed block, returns true if the chain has just gone to sleep
+    bool update( bool inputWasSilent, float outputPeak, int numSamples )
+    {
+        if ( !inputWasSilent )
+        {
+            m_silentSamples = 0;
+            return false;
+        }
+        m_silentSamples += numSamples;
+        if ( m_silentSamples < m_tailSamples || outputPeak > m_threshold ) { return false; }
+        m_isSleeping = true;
+        return true;
+    }
+    //==============================================================================
+private:
+    double m_sampleRate = 44100;
+    juce::int64 m_tailSamples = 0, m_silentSamples = 0;
+    bool m_isSleeping = false;
+    // -100dB
+    static constexpr float m_threshold = 0.00001f;
+};
@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    sjf_spectralMeters.h
+
+    Per band level / feedback meters and a cpu breakdown of processBlock,
+    fed from the processor's metrics fifo once per display refresh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+class sjf_spectralMeters : public juce::Component
+{
+    using blockMetrics = Sjf_spectralProcessorAudioProcessor::blockMetrics;
+public:
+    //==============================================================================
+    sjf_spectralMeters()
+    {
+        setInterceptsMouseClicks( false, false );
+        m_rms.fill( 0.0f );
+        m_peak.fill( 0.0f );
+        m_feedback.fill( 0.0f );
+        m_stageSeconds.fill( 0.0 );
+    }
+    //==============================================================================
+    void addRecord( const blockMetrics& record )
+    {
+        for ( int b = 0; b < m_rms.size(); b++ )
+        {
+            m_newRms[ b ] = std::fmax( m_newRms[ b ], record.bandRms[ b ] );
+            m_newPeak[ b ] = std::fmax( m_newPeak[ b ], record.bandPeak[ b ] );
+            m_newFeedback[ b ] = std::fmax( m_newFeedback[ b ], record.feedbackEnergy[ b ] );
+        }
+        for ( int s = 0; s < m_stageSeconds.size(); s++ ) { m_newStageSeconds[ s ] += record.stageSeconds[ s ]; }
+        m_newDeadlineSeconds += record.deadlineSeconds;
+        m_activeBands = record.activeBands;
+        m_qualityLevel = record.qualityLevel;
+        m_hasNewRecords = true;
+    }
+    //==============================================================================
+    // call once per display refresh, after all waiting records have been added
+    void update()
+    {
+        static constexpr float fallRate = 0.91f; // per refresh, about -50dB a second at 60Hz
+        static constexpr float floor = 0.001f; // -60dB, the bottom of the meters
+        auto isResting = [ & ]( const std::array< float, blockMetrics::numBands >& levels ) { return std::all_of( levels.begin(), levels.end(), [ & ]( float l ){ return l < floor; } ); };
+        // nothing new and everything has already fallen below the meters, so nothing to redraw
+        if ( !m_hasNewRecords && isResting( m_rms ) && isResting( m_peak ) && isResting( m_feedback ) ) { return; }
+        for ( int b = 0; b < m_rms.size(); b++ )
+        {
+            m_rms[ b ] = std::fmax( m_newRms[ b ], m_rms[ b ] * fallRate );
+            m_peak[ b ] = std::fmax( m_newPeak[ b ], m_peak[ b ] * fallRate );
+            m_feedback[ b ] = std::fmax( std::sqrt( m_newFeedback[ b ] ), m_feedback[ b ] * fallRate );
+        }
+        if ( m_hasNewRecords && m_newDeadlineSeconds > 0.0 )
+        {
+            for ( int s = 0; s < m_stageSeconds.size(); s++ ) { m_stageSeconds[ s ] = 100.0 * m_newStageSeconds[ s ] / m_newDeadlineSeconds; }
+        }
+        m_newRms.fill( 0.0f );
+        m_newPeak.fill( 0.0f );
+        m_newFeedback.fill( 0.0f );
+        m_newStageSeconds.fill( 0.0 );
+        m_newDeadlineSeconds = 0.0;
+        m_hasNewRecords = false;
+        repaint();
+    }
+    //==============================================================================
+    void paint( juce::Graphics& g ) override
+    {
+        static constexpr float minDB = -60.0f;
+        static constexpr int textHeight = 20;
+        auto numBands = (int)m_rms.size();
+        auto meterHeight = (float)( getHeight() - textHeight * 2 );
+        auto bandWidth = (float)getWidth() / (float)numBands;
+
+        g.setColour( juce::Colours::black.withAlpha( 0.3f ) );
+        g.fillRect( 0.0f, 0.0f, (float)getWidth(), meterHeight );
+        for ( int b = 0; b < numBands; b++ )
+        {
+            auto x = b * bandWidth;
+            auto isActive = ( m_activeBands >> b ) & 1u;
+            auto rmsHeight = meterHeight * levelToProportion( m_rms[ b ], minDB );
+            auto peakY = meterHeight * ( 1.0f - levelToProportion( m_peak[ b ], minDB ) );
+            auto fbHeight = meterHeight * levelToProportion( m_feedback[ b ], minDB );
+
+            g.setColour( juce::Colours::white.withAlpha( isActive ? 0.8f : 0.25f ) );
+            g.fillRect( x + 1.0f, meterHeight - rmsHeight, bandWidth * 0.6f - 1.0f, rmsHeight );
+            g.setColour( m_peak[ b ] >= 1.0f ? juce::Colours::red : juce::Colours::white );
+            g.fillRect( x + 1.0f, peakY, bandWidth * 0.6f - 1.0f, 1.0f );
+            g.setColour( juce::Colours::orange.withAlpha( 0.8f ) );
+            g.fillRect( x + bandWidth * 0.6f, meterHeight - fbHeight, bandWidth * 0.4f - 1.0f, fbHeight );
+        }
+
+        g.setColour( juce::Colours::white );
+        g.setFont( 12.0f );
+        auto load = m_stageSeconds[ blockMetrics::control ] + m_stageSeconds[ blockMetrics::filters ] + m_stageSeconds[ blockMetrics::dynamics ] + m_stageSeconds[ blockMetrics::delays ] + m_stageSeconds[ blockMetrics::output ];
+        auto quality = m_qualityLevel == 0 ? juce::String() : ", quality -" + juce::String( m_qualityLevel );
+        g.drawFittedText( "cpu " + juce::String( load, 1 ) + "% of block" + quality, 0, (int)meterHeight, getWidth(), textHeight, juce::Justification::centred, 1 );
+        g.drawFittedText( "ctrl " + juce::String( m_stageSeconds[ blockMetrics::control ], 1 )
+                         + " filt " + juce::String( m_stageSeconds[ blockMetrics::filters ], 1 )
+                         + " dyn " + juce::String( m_stageSeconds[ blockMetrics::dynamics ], 1 )
+                         + " dly " + juce::String( m_stageSeconds[ blockMetrics::delays ], 1 )
+                         + " out " + juce::String( m_stageSeconds[ blockMetrics::output ], 1 ),
+                         0, (int)meterHeight + textHeight, getWidth(), textHeight, juce::Justification::centred, 1 );
+    }
+    //==============================================================================
+private:
+    static float levelToProportion( float level, float minDB )
+    {
+        auto dB = juce::Decibels::gainToDecibels( level, minDB );
+        return juce::jlimit( 0.0f, 1.0f, ( dB - minDB ) / -minDB );
+    }
+
+    std::array< float, blockMetrics::numBands > m_rms, m_peak, m_feedback, m_newRms {}, m_newPeak {}, m_newFeedback {};
+    std::array< double, blockMetrics::numStages > m_stageSeconds, m_newStageSeconds {};
+    double m_newDeadlineSeconds = 0.0;
+    juce::uint32 m_activeBands = 0;
+    int m_qualityLevel = 0;
+    bool m_hasNewRecords = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (sjf_spectralMeters)
+};
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    sjf_spectralMetrics.h
+
+    Per block instrumentation passed from the audio thread to the editor
+    through a lock free fifo. Set SJF_SPECTRAL_METRICS to 0 to compile the
+    collection out entirely
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef SJF_SPECTRAL_METRICS
+ #define SJF_SPECTRAL_METRICS 1
+#endif
+
+//==============================================================================
+template< int NUM_BANDS >
+struct sjf_blockMetrics
+{
+    enum stage { control, filters, dynamics, delays, output, numStages };
+    static constexpr int numBands = NUM_BANDS;
+
+    std::array< double, numStages > stageSeconds {};
+    // time available for the block ( numSamples / sampleRate )
+    double deadlineSeconds = 0.0;
+    int numSamples = 0;
+    // sjf_qualityGovernor::level the block ran at
+    int qualityLevel = 0;
+
+    // bands are measured after gain, modulation and delay mix
+    std::array< float, NUM_BANDS > bandRms {}, bandPeak {}, feedbackEnergy {};
+    // bit b is set if band b is routed to the output with a non-zero gain
+    juce::uint32 activeBands = 0;
+};
+
+//==============================================================================
+// single producer / single consumer, the audio thread drops records if the reader falls behind
+template< typename T, int SIZE >
+class sjf_metricsFifo
+{
+public:
+    //==============================================================================
+    bool push( const T& record )
+    {
+        int start1, size1, start2, size2;
+        m_fifo.prepareToWrite( 1, start1, size1, start2, size2 );
+        if ( size1 + size2 == 0 ) { return false; }
+        m_records[ size1 > 0 ? start1 : start2 ] = record;
+        m_fifo.finishedWrite( 1 );
+        return true;
+    }
+    //==============================================================================
+    bool pop( T& record )
+    {
+        int start1, size1, start2, size2;
+        m_fifo.prepareToRead( 1, start1, size1, start2, size2 );
+        if ( size1 + size2 == 0 ) { return false; }
+        record = m_records[ size1 > 0 ? start1 : start2 ];
+        m_fifo.finishedRead( 1 );
+        return true;
+    }
+    //==============================================================================
+private:
+    juce::AbstractFifo m_fifo { SIZE };
+    std::array< T, SIZE > m_records;
+};
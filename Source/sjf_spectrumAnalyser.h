@@ -0,0 +1,287 @@
+/*
+  ==============================================================================
+
+    sjf_spectrumAnalyser.h
+
+    Input/output spectrum for the editor overlay.
+    The audio thread only decimates a mono sum of the input and output into a
+    wait free fifo, the fft and smoothing run on a single background thread
+    shared by every open editor, and the gui just paints the finished curves
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// audio thread side, owned by the processor
+class sjf_analyserFifo
+{
+public:
+    static constexpr int fifoSize = 16384;
+    //==============================================================================
+    sjf_analyserFifo()
+    {
+        m_inputFifo.resize( fifoSize );
+        m_outputFifo.resize( fifoSize );
+    }
+    //==============================================================================
+    // decimate to roughly 44.1kHz, nothing above that is displayed anyway
+    void initialise( double sampleRate, int samplesPerBlock )
+    {
+        m_decimation = juce::jmax( 1, (int)( sampleRate / 44100.0 ) );
+        m_analysisSampleRate = sampleRate / m_decimation;
+        m_inputScratch.resize( samplesPerBlock / m_decimation + 1 );
+        m_outputScratch.resize( samplesPerBlock / m_decimation + 1 );
+        m_phase = 0;
+        m_inputSum = m_outputSum = 0.0f;
+    }
+    //==============================================================================
+    void setEnabled( bool shouldBeEnabled ) { m_enabled = shouldBeEnabled; }
+    bool isEnabled() const { return m_enabled.load(); }
+    double getAnalysisSampleRate() const { return m_analysisSampleRate.load(); }
+    //==============================================================================
+    // call with the input before it is overwritten and then with the output for the same samples
+    void captureInput( const juce::AudioBuffer< float >& buffer, int numChannels, int startSample, int numSamples )
+    {
+        auto phase = m_phase;
+        m_numCaptured = decimate( buffer, numChannels, startSample, numSamples, phase, m_inputSum, m_inputScratch.data() );
+    }
+    //==============================================================================
+    void pushOutput( const juce::AudioBuffer< float >& buffer, int numChannels, int startSample, int numSamples )
+    {
+        auto numDecimated = decimate( buffer, numChannels, startSample, numSamples, m_phase, m_outputSum, m_outputScratch.data() );
+        jassert( numDecimated == m_numCaptured );
+        int start1, size1, start2, size2;
+        m_fifo.prepareToWrite( numDecimated, start1, size1, start2, size2 );
+        // if the reader has fallen behind we just drop samples
+        std::copy( m_inputScratch.begin(), m_inputScratch.begin() + size1, m_inputFifo.begin() + start1 );
+        std::copy( m_outputScratch.begin(), m_outputScratch.begin() + size1, m_outputFifo.begin() + start1 );
+        std::copy( m_inputScratch.begin() + size1, m_inputScratch.begin() + size1 + size2, m_inputFifo.begin() + start2 );
+        std::copy( m_outputScratch.begin() + size1, m_outputScratch.begin() + size1 + size2, m_outputFifo.begin() + start2 );
+        m_fifo.finishedWrite( size1 + size2 );
+    }
+    //==============================================================================
+    // reader side, returns number of samples copied into input/output
+    int read( float* input, float* output, int maxNumSamples )
+    {
+        int start1, size1, start2, size2;
+        m_fifo.prepareToRead( maxNumSamples, start1, size1, start2, size2 );
+        std::copy( m_inputFifo.begin() + start1, m_inputFifo.begin() + start1 + size1, input );
+        std::copy( m_outputFifo.begin() + start1, m_outputFifo.begin() + start1 + size1, output );
+        std::copy( m_inputFifo.begin() + start2, m_inputFifo.begin() + start2 + size2, input + size1 );
+        std::copy( m_outputFifo.begin() + start2, m_outputFifo.begin() + start2 + size2, output + size1 );
+        m_fifo.finishedRead( size1 + size2 );
+        return size1 + size2;
+    }
+    //==============================================================================
+private:
+    int decimate( const juce::AudioBuffer< float >& buffer, int numChannels, int startSample, int numSamples, int& phase, float& sum, float* destination )
+    {
+        auto scale = 1.0f / (float)( numChannels * m_decimation );
+        int count = 0;
+        for ( int i = startSample; i < startSample + numSamples; i++ )
+        {
+            for ( int c = 0; c < numChannels; c++ ) { sum += buffer.getSample( c, i ); }
+            if ( ++phase < m_decimation ) { continue; }
+            destination[ count++ ] = sum * scale;
+            sum = 0.0f;
+            phase = 0;
+        }
+        return count;
+    }
+
+    juce::AbstractFifo m_fifo { fifoSize };
+    std::vector< float > m_inputFifo, m_outputFifo, m_inputScratch, m_outputScratch;
+    std::atomic< bool > m_enabled { false };
+    std::atomic< double > m_analysisSampleRate { 44100.0 };
+    int m_decimation = 1, m_phase = 0, m_numCaptured = 0;
+    float m_inputSum = 0.0f, m_outputSum = 0.0f;
+};
+
+//==============================================================================
+// one thread for every analyser in the process
+class sjf_analyserThread : public juce::TimeSliceThread
+{
+public:
+    sjf_analyserThread() : juce::TimeSliceThread( "sjf_spectrumAnalyser" ) { startThread(); }
+    ~sjf_analyserThread() override { stopThread( 1000 ); }
+};
+
+//==============================================================================
+// fft and smoothing, runs on the shared analyser thread
+// display points are spaced to line up with the band sliders, the band centre frequencies sit in the middle of each column
+class sjf_spectrumAnalyser : private juce::TimeSliceClient
+{
+public:
+    static constexpr int numPoints = 128;
+    using spectrum = std::array< float, numPoints >;
+    //==============================================================================
+    sjf_spectrumAnalyser( sjf_analyserFifo& fifo, std::vector< double > bandFrequencies )
+    : m_fifo( fifo ), m_bandFrequencies( std::move( bandFrequencies ) )
+    {
+        m_inputLevels.fill( 0.0f );
+        m_outputLevels.fill( 0.0f );
+        m_displayInput.fill( 0.0f );
+        m_displayOutput.fill( 0.0f );
+        m_inputHistory.fill( 0.0f );
+        m_outputHistory.fill( 0.0f );
+        m_fifo.setEnabled( true );
+        m_thread->addTimeSliceClient( this );
+    }
+    //==============================================================================
+    ~sjf_spectrumAnalyser() override
+    {
+        m_thread->removeTimeSliceClient( this );
+        m_fifo.setEnabled( false );
+    }
+    //==============================================================================
+    // message thread, returns false if nothing has changed since the last call
+    bool getSpectra( spectrum& input, spectrum& output )
+    {
+        if ( !m_hasNewSpectra.exchange( false ) ) { return false; }
+        const juce::SpinLock::ScopedLockType lock( m_displayLock );
+        input = m_displayInput;
+        output = m_displayOutput;
+        return true;
+    }
+    //==============================================================================
+private:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 2;
+    static constexpr float minDB = -90.0f;
+    //==============================================================================
+    int useTimeSlice() override
+    {
+        auto numRead = m_fifo.read( m_inputHistory.data() + m_historyWritePosition, m_outputHistory.data() + m_historyWritePosition, fftSize - m_historyWritePosition );
+        m_historyWritePosition += numRead;
+        if ( m_historyWritePosition < fftSize ) { return 20; }
+
+        auto sampleRate = m_fifo.getAnalysisSampleRate();
+        if ( sampleRate != m_mappedSampleRate ) { calculatePointBins( sampleRate ); }
+
+        analyse( m_inputHistory, m_inputLevels );
+        analyse( m_outputHistory, m_outputLevels );
+        {
+            const juce::SpinLock::ScopedLockType lock( m_displayLock );
+            m_displayInput = m_inputLevels;
+            m_displayOutput = m_outputLevels;
+        }
+        m_hasNewSpectra = true;
+
+        // keep the second half for the next (50% overlapped) frame
+        std::copy( m_inputHistory.begin() + hopSize, m_inputHistory.begin() + fftSize, m_inputHistory.begin() );
+        std::copy( m_outputHistory.begin() + hopSize, m_outputHistory.begin() + fftSize, m_outputHistory.begin() );
+        m_historyWritePosition = fftSize - hopSize;
+        return 0;
+    }
+    //==============================================================================
+    void analyse( const std::array< float, fftSize >& history, spectrum& levels )
+    {
+        static constexpr float release = 0.85f;
+        std::copy( history.begin(), history.end(), m_fftData.begin() );
+        m_window.multiplyWithWindowingTable( m_fftData.data(), fftSize );
+        m_fft.performFrequencyOnlyForwardTransform( m_fftData.data() );
+        // a full scale sine peaks at fftSize / 4 with a hann window
+        auto normalise = 4.0f / (float)fftSize;
+        for ( int p = 0; p < numPoints; p++ )
+        {
+            auto bin = m_pointBins[ p ];
+            auto index = (int)bin;
+            auto frac = bin - index;
+            auto magnitude = m_fftData[ index ] + frac * ( m_fftData[ index + 1 ] - m_fftData[ index ] );
+            auto dB = juce::Decibels::gainToDecibels( magnitude * normalise, minDB );
+            auto level = ( dB - minDB ) / -minDB;
+            levels[ p ] = std::fmax( level, levels[ p ] * release );
+        }
+    }
+    //==============================================================================
+    // frequency at each display point, interpolated logarithmically between band centres
+    void calculatePointBins( double sampleRate )
+    {
+        auto numBands = (int)m_bandFrequencies.size();
+        auto binWidth = sampleRate / fftSize;
+        for ( int p = 0; p < numPoints; p++ )
+        {
+            auto column = ( ( p + 0.5 ) / numPoints ) * numBands - 0.5;
+            auto lower = juce::jlimit( 0, numBands - 2, (int)std::floor( column ) );
+            auto logLow = std::log( m_bandFrequencies[ lower ] );
+            auto logHigh = std::log( m_bandFrequencies[ lower + 1 ] );
+            auto frequency = std::exp( logLow + ( column - lower ) * ( logHigh - logLow ) );
+            frequency = juce::jlimit( 20.0, sampleRate * 0.5, frequency );
+            m_pointBins[ p ] = (float)juce::jmin( frequency / binWidth, fftSize * 0.5 - 1.0 );
+        }
+        m_mappedSampleRate = sampleRate;
+    }
+    //==============================================================================
+    juce::SharedResourcePointer< sjf_analyserThread > m_thread;
+    sjf_analyserFifo& m_fifo;
+    std::vector< double > m_bandFrequencies;
+
+    juce::dsp::FFT m_fft { fftOrder };
+    juce::dsp::WindowingFunction< float > m_window { fftSize, juce::dsp::WindowingFunction< float >::hann, false };
+    std::array< float, fftSize > m_inputHistory, m_outputHistory;
+    std::array< float, fftSize * 2 > m_fftData;
+    std::array< float, numPoints > m_pointBins;
+    int m_historyWritePosition = 0;
+    double m_mappedSampleRate = 0.0;
+
+    spectrum m_inputLevels, m_outputLevels, m_displayInput, m_displayOutput;
+    juce::SpinLock m_displayLock;
+    std::atomic< bool > m_hasNewSpectra { false };
+};
+
+//==============================================================================
+// transparent overlay, placed over the band gain sliders
+class sjf_spectrumDisplay : public juce::Component
+{
+public:
+    sjf_spectrumDisplay()
+    {
+        setInterceptsMouseClicks( false, false );
+        m_input.fill( 0.0f );
+        m_output.fill( 0.0f );
+    }
+    //==============================================================================
+    void setSpectra( const sjf_spectrumAnalyser::spectrum& input, const sjf_spectrumAnalyser::spectrum& output )
+    {
+        m_input = input;
+        m_output = output;
+        repaint();
+    }
+    //==============================================================================
+    void paint( juce::Graphics& g ) override
+    {
+        g.setColour( juce::Colours::white.withAlpha( 0.2f ) );
+        g.fillPath( createPath( m_output, true ) );
+        g.setColour( juce::Colours::lightblue.withAlpha( 0.5f ) );
+        g.strokePath( createPath( m_input, false ), juce::PathStrokeType( 1.0f ) );
+    }
+    //==============================================================================
+private:
+    juce::Path createPath( const sjf_spectrumAnalyser::spectrum& levels, bool closed )
+    {
+        auto w = (float)getWidth();
+        auto h = (float)getHeight();
+        juce::Path p;
+        p.preallocateSpace( ( (int)levels.size() + 2 ) * 3 );
+        p.startNewSubPath( 0.0f, closed ? h : h * ( 1.0f - levels[ 0 ] ) );
+        for ( int i = 0; i < levels.size(); i++ )
+        {
+            p.lineTo( w * ( i + 0.5f ) / (float)levels.size(), h * ( 1.0f - juce::jlimit( 0.0f, 1.0f, levels[ i ] ) ) );
+        }
+        if ( closed )
+        {
+            p.lineTo( w, h );
+            p.closeSubPath();
+        }
+        return p;
+    }
+
+    sjf_spectrumAnalyser::spectrum m_input, m_output;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (sjf_spectrumDisplay)
+};
@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless batch renderer. Every input file is run through its own
+    processor instance, loaded with the same state and random seed, so a
+    file renders identically whatever else is running alongside it. Workers
+    take the next file from a shared counter until there are none left.
+    Audio is streamed through in blocks, it is never all held in memory
+
+    sjf_spectralRender --state <state file> --out <directory> [options] <input files...>
+        --state     plugin state, either saved from getStateInformation or as xml
+        --out       directory the renders are written to ( same names as the inputs, as wav )
+        --threads   number of workers, defaults to the number of cpus
+        --block     block size to process with, defaults to 512
+        --tail      seconds of silence to render after each input, defaults to 0
+        --bits      16, 24 or 32 ( float ), defaults to 24
+        --seed      seed for the processor's random delay fluctuations, defaults to 1
+
+    sjf_spectralRender --benchmark <instances> [--state <state file>]
+        times creating, loading and preparing that many instances, the way a
+        session load would, then reports the average cost of each stage
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <thread>
+#include "sjf_renderer.h"
+
+//==============================================================================
+struct renderSettings
+{
+    juce::MemoryBlock state;
+    juce::File outputDirectory;
+    int blockSize = 512, bitsPerSample = 24;
+    double tailSeconds = 0.0;
+    juce::int64 seed = 1;
+};
+
+//==============================================================================
+// returns an empty string on success, otherwise what went wrong
+static juce::String renderFile( const juce::File& inputFile, const renderSettings& settings )
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    std::unique_ptr< juce::AudioFormatReader > reader( formatManager.createReaderFor( inputFile ) );
+    if ( reader == nullptr ) { return "couldn't read " + inputFile.getFullPathName(); }
+
+    const auto sampleRate = reader->sampleRate;
+    const int numChannels = juce::jlimit( 1, 2, (int)reader->numChannels );
+
+    sjf_renderer renderer( settings.state, numChannels, sampleRate, settings.blockSize, settings.seed );
+
+    auto outputFile = settings.outputDirectory.getChildFile( inputFile.getFileNameWithoutExtension() + ".wav" );
+    outputFile.deleteFile();
+    auto stream = outputFile.createOutputStream();
+    if ( stream == nullptr ) { return "couldn't open " + outputFile.getFullPathName(); }
+    juce::WavAudioFormat wav;
+    std::unique_ptr< juce::AudioFormatWriter > writer( wav.createWriterFor( stream.get(), sampleRate, (unsigned int)numChannels, settings.bitsPerSample, {}, 0 ) );
+    if ( writer == nullptr ) { return "couldn't create a writer for " + outputFile.getFullPathName(); }
+    stream.release(); // the writer owns it now
+
+    auto read = [ &reader, numChannels ]( juce::AudioBuffer< float >& buffer, juce::int64 position, int numSamples )
+    {
+        // mono files are read into every channel
+        reader->read( &buffer, 0, numSamples, position, true, numChannels > 1 );
+    };
+    auto write = [ &writer ]( const juce::AudioBuffer< float >& buffer, int startSample, int numSamples ) { return writer->writeFromAudioSampleBuffer( buffer, startSample, numSamples ); };
+    if ( !renderer.run( reader->lengthInSamples, (juce::int64)std::ceil( settings.tailSeconds * sampleRate ), read, write ) )
+    {
+        return "couldn't write " + outputFile.getFullPathName();
+    }
+    return {};
+}
+
+//==============================================================================
+static bool loadState( const juce::File& stateFile, juce::MemoryBlock& state )
+{
+    // xml is converted to the same binary format the plugin saves
+    if ( auto xml = juce::parseXML( stateFile ) )
+    {
+        juce::AudioProcessor::copyXmlToBinary( *xml, state );
+        return true;
+    }
+    return stateFile.loadFileAsData( state );
+}
+
+//==============================================================================
+static void benchmarkStartup( const int numInstances, const juce::MemoryBlock& state )
+{
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 512;
+    enum stage { construct, loadState, prepare, prepareAgain, numStages };
+    static const std::array< const char*, numStages > names { "construct", "load state", "prepare", "prepare again" };
+    std::array< double, numStages > seconds {};
+    auto time = [ &seconds ]( int s, auto&& function )
+    {
+        auto startTicks = juce::Time::getHighResolutionTicks();
+        function();
+        seconds[ s ] += juce::Time::highResolutionTicksToSeconds( juce::Time::getHighResolutionTicks() - startTicks );
+    };
+
+    // all kept alive until the end, like the instances in a session
+    std::vector< std::unique_ptr< Sjf_spectralProcessorAudioProcessor > > instances;
+    for ( int i = 0; i < numInstances; i++ )
+    {
+        time( construct, [ & ]() { instances.push_back( std::make_unique< Sjf_spectralProcessorAudioProcessor >() ); } );
+        auto& processor = *instances.back();
+        processor.setPlayConfigDetails( 2, 2, sampleRate, blockSize );
+        if ( state.getSize() > 0 ) { time( loadState, [ & ]() { processor.setStateInformation( state.getData(), (int)state.getSize() ); } ); }
+        time( prepare, [ & ]() { processor.prepareToPlay( sampleRate, blockSize ); } );
+        time( prepareAgain, [ & ]() { processor.prepareToPlay( sampleRate, blockSize ); } );
+    }
+
+    double total = 0.0;
+    for ( int s = 0; s < numStages; s++ )
+    {
+        std::cout << names[ s ] << ": " << juce::String( 1000.0 * seconds[ s ] / numInstances, 3 ) << "ms per instance" << std::endl;
+        total += seconds[ s ];
+    }
+    std::cout << numInstances << " instances in " << juce::String( total, 2 ) << "s" << std::endl;
+}
+
+//==============================================================================
+int main( int argc, char* argv[] )
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    renderSettings settings;
+    juce::File stateFile;
+    int numThreads = juce::SystemStats::getNumCpus();
+    juce::Array< juce::File > inputFiles;
+    int benchmarkInstances = 0;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        juce::String argument( argv[ i ] );
+        auto hasValue = i + 1 < argc;
+        auto value = [ & ]() { return juce::String( argv[ ++i ] ); };
+        if ( argument == "--state" && hasValue ) { stateFile = juce::File::getCurrentWorkingDirectory().getChildFile( value() ); }
+        else if ( argument == "--out" && hasValue ) { settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile( value() ); }
+        else if ( argument == "--threads" && hasValue ) { numThreads = value().getIntValue(); }
+        else if ( argument == "--block" && hasValue ) { settings.blockSize = value().getIntValue(); }
+        else if ( argument == "--tail" && hasValue ) { settings.tailSeconds = value().getDoubleValue(); }
+        else if ( argument == "--bits" && hasValue ) { settings.bitsPerSample = value().getIntValue(); }
+        else if ( argument == "--seed" && hasValue ) { settings.seed = value().getLargeIntValue(); }
+        else if ( argument == "--benchmark" && hasValue ) { benchmarkInstances = value().getIntValue(); }
+        else if ( argument.startsWith( "--" ) ) { std::cerr << "unknown option " << argument << std::endl; return 1; }
+        else { inputFiles.add( juce::File::getCurrentWorkingDirectory().getChildFile( argument ) ); }
+    }
+
+    if ( benchmarkInstances > 0 )
+    {
+        if ( stateFile != juce::File() && !loadState( stateFile, settings.state ) ) { std::cerr << "couldn't load " << stateFile.getFullPathName() << std::endl; return 1; }
+        benchmarkStartup( benchmarkInstances, settings.state );
+        return 0;
+    }
+    if ( !stateFile.existsAsFile() || settings.outputDirectory == juce::File() || inputFiles.isEmpty() )
+    {
+        std::cerr << "usage: sjf_spectralRender --state <state file> --out <directory> [--threads n] [--block samples] [--tail seconds] [--bits 16|24|32] [--seed n] <input files...>" << std::endl;
+        std::cerr << "       sjf_spectralRender --benchmark <instances> [--state <state file>]" << std::endl;
+        return 1;
+    }
+    if ( !loadState( stateFile, settings.state ) ) { std::cerr << "couldn't load " << stateFile.getFullPathName() << std::endl; return 1; }
+    if ( !settings.outputDirectory.createDirectory() ) { std::cerr << "couldn't create " << settings.outputDirectory.getFullPathName() << std::endl; return 1; }
+    settings.blockSize = juce::jlimit( 16, 65536, settings.blockSize );
+    settings.tailSeconds = std::max( settings.tailSeconds, 0.0 );
+    if ( settings.bitsPerSample != 16 && settings.bitsPerSample != 32 ) { settings.bitsPerSample = 24; }
+    numThreads = juce::jlimit( 1, inputFiles.size(), numThreads );
+
+    // one file per job, whichever worker is free takes the next one
+    std::atomic< int > nextFile { 0 }, numFailed { 0 };
+    std::mutex outputLock;
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    auto work = [ & ]()
+    {
+        for ( int f = nextFile++; f < inputFiles.size(); f = nextFile++ )
+        {
+            auto fileStartTicks = juce::Time::getHighResolutionTicks();
+            auto error = renderFile( inputFiles[ f ], settings );
+            auto seconds = juce::Time::highResolutionTicksToSeconds( juce::Time::getHighResolutionTicks() - fileStartTicks );
+            std::lock_guard< std::mutex > lock( outputLock );
+            if ( error.isNotEmpty() ) { numFailed++; std::cerr << "failed: " << error << std::endl; }
+            else { std::cout << inputFiles[ f ].getFileName() << " ( " << juce::String( seconds, 2 ) << "s )" << std::endl; }
+        }
+    };
+    std::vector< std::thread > workers;
+    for ( int t = 1; t < numThreads; t++ ) { workers.emplace_back( work ); }
+    work();
+    for ( auto& worker : workers ) { worker.join(); }
+
+    auto seconds = juce::Time::highResolutionTicksToSeconds( juce::Time::getHighResolutionTicks() - startTicks );
+    std::cout << inputFiles.size() - numFailed << " of " << inputFiles.size() << " files rendered with " << numThreads << " threads in " << juce::String( seconds, 2 ) << "s" << std::endl;
+    return numFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    sjf_renderer.h
+
+    The processor set up for a render, the same way every time: seeded,
+    switched to offline, loaded with the state and prepared. run pulls the
+    input through in blocks and hands on the output with the processor's
+    latency already dropped, so it lines up with the input. Shared by the
+    batch renderer and the regression tests, so the reference renders are
+    made exactly the way the renderer makes them. The tests can also give
+    it a bus layout ( sidechain and aux outputs ) and feed it midi
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+class sjf_renderer
+{
+public:
+    //==============================================================================
+    // offline selects the render quality profile, the tests also render with the realtime settings.
+    // Without a layout only the main buses are used, with numChannels in and out. With one, the buffers
+    // hold every enabled bus in the processor's channel order, the main buses first
+    sjf_renderer( const juce::MemoryBlock& state, const int numChannels, const double sampleRate, const int blockSize, const juce::int64 seed, const bool offline = true, const juce::AudioProcessor::BusesLayout& layout = {} )
+        : m_blockSize( blockSize )
+    {
+       #if ! SJF_BASELINE_REFERENCES
+        m_processor.setRandomSeed( seed );
+       #else
+        juce::ignoreUnused( seed );
+       #endif
+        m_processor.setNonRealtime( offline );
+        if ( layout.outputBuses.isEmpty() ) { m_processor.setPlayConfigDetails( numChannels, numChannels, sampleRate, blockSize ); }
+        else
+        {
+            auto applied = m_processor.setBusesLayout( layout );
+            jassert( applied );
+            juce::ignoreUnused( applied );
+            m_processor.setRateAndBufferSizeDetails( sampleRate, blockSize );
+        }
+        m_numChannels = std::max( m_processor.getTotalNumInputChannels(), m_processor.getTotalNumOutputChannels() );
+        if ( state.getSize() > 0 ) { m_processor.setStateInformation( state.getData(), (int)state.getSize() ); }
+        m_processor.prepareToPlay( sampleRate, blockSize );
+    }
+    //==============================================================================
+    ~sjf_renderer() { m_processor.releaseResources(); }
+    //==============================================================================
+    // read( buffer, position, numSamples ) fills the start of the cleared buffer with that much input,
+    // write( buffer, startSample, numSamples ) takes each block of output and returns false to stop.
+    // Runs for inputLength + tailLength samples of output
+    template< typename READ, typename WRITE >
+    bool run( const juce::int64 inputLength, const juce::int64 tailLength, READ&& read, WRITE&& write )
+    {
+        return run( inputLength, tailLength, read, write, []( juce::MidiBuffer&, juce::int64, int ) {} );
+    }
+    //==============================================================================
+    // midi( buffer, position, numSamples ) adds the block's events to the cleared buffer, at positions within the block.
+    // Positions count from the first block, the latency isn't taken off them
+    template< typename READ, typename WRITE, typename MIDI >
+    bool run( const juce::int64 inputLength, const juce::int64 tailLength, READ&& read, WRITE&& write, MIDI&& midi )
+    {
+        // the output is shifted back by the processor's latency, so run that much longer and drop the start
+        const auto latency = (juce::int64)m_processor.getLatencySamples();
+        const auto totalLength = inputLength + tailLength + latency;
+        juce::AudioBuffer< float > buffer( m_numChannels, m_blockSize );
+        juce::MidiBuffer midiMessages;
+        for ( juce::int64 position = 0; position < totalLength; position += m_blockSize )
+        {
+            auto numSamples = (int)std::min( (juce::int64)m_blockSize, totalLength - position );
+            buffer.setSize( m_numChannels, numSamples, false, false, true );
+            buffer.clear();
+            if ( position < inputLength ) { read( buffer, position, (int)std::min( (juce::int64)numSamples, inputLength - position ) ); }
+            midiMessages.clear();
+            midi( midiMessages, position, numSamples );
+            m_processor.processBlock( buffer, midiMessages );
+
+            auto skip = (int)juce::jlimit( (juce::int64)0, (juce::int64)numSamples, latency - position );
+            if ( skip < numSamples && !write( buffer, skip, numSamples - skip ) ) { return false; }
+        }
+        return true;
+    }
+    //==============================================================================
+    Sjf_spectralProcessorAudioProcessor& getProcessor() { return m_processor; }
+    //==============================================================================
+private:
+    Sjf_spectralProcessorAudioProcessor m_processor;
+    const int m_blockSize;
+    int m_numChannels;
+};
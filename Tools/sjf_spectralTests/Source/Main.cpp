@@ -0,0 +1,756 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Regression tests for the processor. A fixed signal ( an impulse, a log
+    sweep and noise, different on each channel ) is rendered through a
+    matrix of settings with sjf_renderer, the same code the batch renderer
+    uses, and checked against stored reference renders and against itself:
+    - reference    every case against its reference render, within a tolerance
+    - block size   other block sizes, at 44.1, 48 and 96kHz, give the same output as 512,
+                   midi included, its events land at the same sample however the blocks split
+    - dispatch     every instruction set level the cpu has gives exactly the baseline's output
+    - bad values   nan / inf input is silenced, and nothing non finite or denormal ever comes out
+    - dual mono    identical channels give identical output, and a channel that stops being
+                   identical carries on exactly as if it had been processed on its own
+    - static chain the realtime chain gives the same output once the convolution kernel has taken over
+    - aux          enabling the aux outputs holds multirate off
+
+    Cases render with the realtime settings, so every interpolation and
+    storage format is covered, apart from the ones named render-profile.
+    The vocoder cases have the input played backwards on the sidechain,
+    the aux cases also check the first two aux outputs, and the governor
+    cases hold it at each level with sjf_qualityGovernor::setOverride
+
+    The references for every case the original plugin could already play
+    are rendered by the original plugin, so the rewrites are held to how it
+    sounded. Built with SJF_BASELINE_REFERENCES=1 against that source only
+    those cases are rendered, the rest come from a reviewed build of this
+    one ( see the readme )
+
+    sjf_spectralTests [--references <directory>] [--update-references] [--filter <text>]
+        --references          where the reference renders are kept, defaults to ./References
+        --update-references   writes this build's share of the reference renders instead of
+                              checking against them ( see the readme )
+        --filter              only runs the tests whose names contain the text
+    Returns 0 when every test passed
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../sjf_spectralRender/Source/sjf_renderer.h"
+
+//==============================================================================
+namespace
+{
+    using processor = Sjf_spectralProcessorAudioProcessor;
+    constexpr juce::int64 SEED = 1;
+    constexpr double SIGNAL_SECONDS = 2.0, TAIL_SECONDS = 1.0;
+    constexpr int REFERENCE_BLOCK_SIZE = 512;
+    constexpr double REFERENCE_SAMPLE_RATE = 48000.0;
+    // peak error relative to the reference's peak. Different compilers or standard libraries can change the last bits,
+    // feedback and high order filters make more of that
+    constexpr double REFERENCE_TOLERANCE_DB = -90.0, FEEDBACK_REFERENCE_TOLERANCE_DB = -70.0;
+    // the same build should be exact, this only leaves room for nothing more than rounding
+    constexpr double INVARIANCE_TOLERANCE_DB = -120.0;
+    // the kernel is cut once its tail is 100dB down
+    constexpr double STATIC_TOLERANCE_DB = -80.0;
+    // the noise lfo has a generator of its own that can't be seeded, so those renders are only compared by level
+    constexpr double STATISTICAL_TOLERANCE_DB = 1.0;
+    // enough aux outputs to hear the routing without making the references huge
+    constexpr int AUX_BUSES_TESTED = 2;
+}
+
+//==============================================================================
+// everything a case changes from the defaults
+struct testSettings
+{
+    // values match the parameters
+    int filterDesign = 1, filterOrder = 4, bands = 1, lfoType = 1, delayInterpolation = 1, delayStorage = 1;
+    int feedbackMatrix = 1, dynamicsMode = 1, dynamicsDetector = 1, envelopeTarget = 1, auxRouting = 1, delayMemory = 32;
+    // 0 leaves the governor off, the same as it running at full quality
+    int governorLevel = 0;
+    bool multirate = false, lfos = false, delays = false, vocoder = false, auxBuses = false, midi = false;
+    float feedback = 0.5f, maxDelayTime = 0.1f;
+
+    // everything the original plugin had, so the reference comes from it
+    bool existsInBaseline() const
+    {
+        return !multirate && !vocoder && !auxBuses && !midi && governorLevel == 0 && feedbackMatrix == 1 && dynamicsMode == 1 && envelopeTarget == 1
+            && maxDelayTime == 0.1f && delayMemory == 32 && ( !delays || ( delayInterpolation == 1 && delayStorage == 1 ) );
+    }
+    // the baseline's delay times wobbled with an unseeded random, so its delay renders can only be compared by level too
+    bool isDeterministic() const { return !( lfos && lfoType == 2 ) && !( delays && existsInBaseline() ); }
+    bool hasFeedback() const { return delays && feedback > 0.0f; }
+    juce::String getName() const
+    {
+        juce::String name = "design" + juce::String( filterDesign ) + "-order" + juce::String( filterOrder ) + "-bands" + juce::String( bands );
+        if ( multirate ) { name << "-multirate"; }
+        if ( lfos ) { name << "-lfo" << lfoType; }
+        if ( delays ) { name << "-delay" << delayInterpolation << "-storage" << delayStorage; }
+        if ( feedbackMatrix != 1 ) { name << "-matrix" << feedbackMatrix; }
+        if ( maxDelayTime != 0.1f ) { name << "-maxdelay" << juce::String( maxDelayTime, 1 ); }
+        if ( delayMemory != 32 ) { name << "-memory" << delayMemory; }
+        if ( dynamicsMode != 1 ) { name << "-dynamics" << dynamicsMode << "-detector" << dynamicsDetector; }
+        if ( envelopeTarget != 1 ) { name << "-envelope" << envelopeTarget; }
+        if ( vocoder ) { name << "-vocoder"; }
+        if ( auxBuses ) { name << "-aux" << auxRouting; }
+        if ( midi ) { name << "-midi"; }
+        if ( governorLevel > 0 ) { name << "-governor" << governorLevel; }
+        return name;
+    }
+};
+
+//==============================================================================
+static void setParameter( juce::AudioProcessor& audioProcessor, const juce::String& parameterID, const float value )
+{
+    for ( auto* parameter : audioProcessor.getParameters() )
+    {
+        auto* ranged = dynamic_cast< juce::RangedAudioParameter* >( parameter );
+        if ( ranged != nullptr && ranged->getParameterID() == parameterID )
+        {
+            ranged->setValueNotifyingHost( ranged->convertTo0to1( value ) );
+            return;
+        }
+    }
+    std::cerr << "no parameter called " << parameterID << std::endl;
+    jassertfalse;
+}
+
+//==============================================================================
+// the state the renders are loaded with, saved from a processor the way a session would save it
+static juce::MemoryBlock makeState( const testSettings& settings )
+{
+    processor audioProcessor;
+    setParameter( audioProcessor, "filterDesign", (float)settings.filterDesign );
+    setParameter( audioProcessor, "filterOrder", (float)settings.filterOrder );
+    setParameter( audioProcessor, "bands", (float)settings.bands );
+    setParameter( audioProcessor, "lfoType", (float)settings.lfoType );
+   #if ! SJF_BASELINE_REFERENCES
+    setParameter( audioProcessor, "delayInterpolation", (float)settings.delayInterpolation );
+    setParameter( audioProcessor, "delayStorage", (float)settings.delayStorage );
+    setParameter( audioProcessor, "multirate", settings.multirate ? 1.0f : 0.0f );
+    setParameter( audioProcessor, "feedbackMatrix", (float)settings.feedbackMatrix );
+    setParameter( audioProcessor, "maxDelayTime", settings.maxDelayTime );
+    setParameter( audioProcessor, "delayMemory", (float)settings.delayMemory );
+    setParameter( audioProcessor, "dynamicsMode", (float)settings.dynamicsMode );
+    setParameter( audioProcessor, "dynamicsDetector", (float)settings.dynamicsDetector );
+    setParameter( audioProcessor, "envelopeTarget", (float)settings.envelopeTarget );
+    setParameter( audioProcessor, "vocoder", settings.vocoder ? 1.0f : 0.0f );
+    setParameter( audioProcessor, "auxRouting", (float)settings.auxRouting );
+    setParameter( audioProcessor, "governor", settings.governorLevel > 0 ? 1.0f : 0.0f );
+    if ( settings.feedbackMatrix == 4 )
+    {
+        // every band feeding a few others with mixed signs, setCustomFeedbackMatrix scales it down to a gain of 1
+        auto custom = audioProcessor.getCustomFeedbackMatrix();
+        for ( size_t i = 0; i < custom.size(); i++ ) { custom[ i ] = (float)( (int)( ( i * 7 ) % 5 ) - 2 ) * 0.25f; }
+        audioProcessor.setCustomFeedbackMatrix( custom );
+    }
+   #endif
+
+    // spread out so neighbouring bands differ, every preset the same so the xy pad doesn't matter,
+    // unless the case plays midi, which needs the presets to differ to hear the recalls and pad moves
+    const int numBands = audioProcessor.getNumBands();
+    for ( int b = 0; b < numBands; b++ )
+    {
+        auto spread = []( int band, int step ) { return (double)( ( band * step ) % 16 ) / 15.0; };
+        const double gain = 0.3 + 0.7 * spread( b, 5 ), lfoRate = 0.2 + 0.5 * spread( b, 3 ), lfoDepth = settings.lfos ? 0.5 : 0.0;
+        const double delayTime = 0.05 + 0.9 * spread( b, 7 ), feedback = settings.feedback * ( 0.5 + 0.5 * spread( b, 11 ) ), delayMix = 0.5;
+        for ( int preset = 0; preset < 4; preset++ )
+        {
+            audioProcessor.setBandGain( preset, b, settings.midi ? gain * ( 1.0 - 0.2 * preset ) : gain );
+            audioProcessor.setLFORate( preset, b, lfoRate );
+            audioProcessor.setLFODepth( preset, b, lfoDepth );
+            audioProcessor.setDelayTime( preset, b, delayTime );
+            audioProcessor.setFeedback( preset, b, feedback );
+            audioProcessor.setDelayMix( preset, b, delayMix );
+        }
+        audioProcessor.setBandGain( b, gain );
+        audioProcessor.setLFORate( b, lfoRate );
+        audioProcessor.setLFODepth( b, lfoDepth );
+        audioProcessor.setDelayTime( b, delayTime );
+        audioProcessor.setFeedback( b, feedback );
+        audioProcessor.setDelayMix( b, delayMix );
+        audioProcessor.setLfoOn( b, settings.lfos );
+        audioProcessor.setDelayOn( b, settings.delays );
+    }
+    juce::MemoryBlock state;
+    audioProcessor.getStateInformation( state );
+    return state;
+}
+
+//==============================================================================
+// an impulse, a log sweep and then noise, each in its own stretch so a failure shows which one went wrong.
+// The second channel has the sweep upside down and different noise, so the channels are never linked
+static juce::AudioBuffer< float > makeTestSignal( const double sampleRate, const int numChannels )
+{
+    const int length = (int)( SIGNAL_SECONDS * sampleRate );
+    juce::AudioBuffer< float > signal( numChannels, length );
+    signal.clear();
+    const int sweepStart = length / 8, sweepEnd = length * 5 / 8;
+    const double startFrequency = 20.0, endFrequency = 0.45 * sampleRate, sweepSeconds = ( sweepEnd - sweepStart ) / sampleRate;
+    const double k = std::log( endFrequency / startFrequency );
+    for ( int channel = 0; channel < numChannels; channel++ )
+    {
+        auto* samples = signal.getWritePointer( channel );
+        samples[ 0 ] = 1.0f;
+        const float polarity = channel == 0 ? 1.0f : -1.0f;
+        for ( int i = sweepStart; i < sweepEnd; i++ )
+        {
+            auto t = ( i - sweepStart ) / sampleRate;
+            auto phase = juce::MathConstants< double >::twoPi * startFrequency * sweepSeconds / k * ( std::exp( t * k / sweepSeconds ) - 1.0 );
+            samples[ i ] = polarity * 0.5f * (float)std::sin( phase );
+        }
+        juce::Random random( SEED + channel );
+        for ( int i = sweepEnd + length / 16; i < length; i++ ) { samples[ i ] = 0.25f * ( random.nextFloat() * 2.0f - 1.0f ); }
+    }
+    return signal;
+}
+
+//==============================================================================
+// the input played backwards, so the sidechain's spectrum never follows the input's
+static juce::AudioBuffer< float > makeSidechainSignal( const juce::AudioBuffer< float >& input )
+{
+    juce::AudioBuffer< float > sidechain( input );
+    sidechain.reverse( 0, sidechain.getNumSamples() );
+    return sidechain;
+}
+
+//==============================================================================
+// the processor's own layout with the buses the case uses switched on, each with as many channels as the main buses
+static juce::AudioProcessor::BusesLayout makeLayout( const testSettings& settings, const int numChannels )
+{
+    processor audioProcessor;
+    auto layout = audioProcessor.getBusesLayout();
+    const auto set = numChannels == 1 ? juce::AudioChannelSet::mono() : juce::AudioChannelSet::stereo();
+    layout.inputBuses.getReference( 0 ) = set;
+    layout.outputBuses.getReference( 0 ) = set;
+    for ( int bus = 1; bus < layout.inputBuses.size(); bus++ ) { layout.inputBuses.getReference( bus ) = settings.vocoder ? set : juce::AudioChannelSet::disabled(); }
+    for ( int bus = 1; bus < layout.outputBuses.size(); bus++ ) { layout.outputBuses.getReference( bus ) = settings.auxBuses && bus <= AUX_BUSES_TESTED ? set : juce::AudioChannelSet::disabled(); }
+    return layout;
+}
+
+//==============================================================================
+// a preset recall, pad moves, band gain controllers and a note, at times that don't fall on any of the block sizes' boundaries.
+// Numbers match the readme's midi section
+static void addMidiEvents( juce::MidiBuffer& midi, const double sampleRate, const juce::int64 position, const int numSamples )
+{
+    static const std::vector< std::pair< double, juce::MidiMessage > > events {
+        { 0.0213, juce::MidiMessage::programChange( 1, 1 ) },
+        { 0.3117, juce::MidiMessage::controllerEvent( 1, 16, 90 ) },
+        { 0.4531, juce::MidiMessage::controllerEvent( 1, 17, 40 ) },
+        { 0.7919, juce::MidiMessage::controllerEvent( 1, 21, 20 ) },
+        { 1.0307, juce::MidiMessage::noteOn( 1, 36, (juce::uint8)100 ) },
+        { 1.3001, juce::MidiMessage::programChange( 1, 3 ) },
+        { 1.6663, juce::MidiMessage::controllerEvent( 1, 16, 10 ) } };
+    for ( auto& event : events )
+    {
+        auto samplePosition = (juce::int64)( event.first * sampleRate ) - position;
+        if ( samplePosition >= 0 && samplePosition < numSamples ) { midi.addEvent( event.second, (int)samplePosition ); }
+    }
+}
+
+//==============================================================================
+// afterBlock is called with the processor after every block, for anything that has to happen between them.
+// The output has the main channels and then the aux outputs the case switched on
+static juce::AudioBuffer< float > render( const testSettings& settings, const juce::MemoryBlock& state, const juce::AudioBuffer< float >& input, const double sampleRate, const int blockSize, const bool offline = false, std::function< void( processor& ) > afterBlock = nullptr )
+{
+    const int numChannels = input.getNumChannels();
+    const auto tailLength = (int)( TAIL_SECONDS * sampleRate );
+    const bool hasExtraBuses = settings.vocoder || settings.auxBuses;
+   #if ! SJF_BASELINE_REFERENCES
+    sjf_qualityGovernor::setOverride( settings.governorLevel > 0 ? settings.governorLevel : -1 );
+   #endif
+    sjf_renderer renderer( state, numChannels, sampleRate, blockSize, SEED, offline, hasExtraBuses ? makeLayout( settings, numChannels ) : juce::AudioProcessor::BusesLayout() );
+    // the sidechain's channels follow the main input's in the buffer, the aux outputs' follow the main output's
+    const int numInputs = renderer.getProcessor().getTotalNumInputChannels(), numOutputs = renderer.getProcessor().getTotalNumOutputChannels();
+    const auto sidechain = numInputs > numChannels ? makeSidechainSignal( input ) : juce::AudioBuffer< float >();
+    juce::AudioBuffer< float > output( numOutputs, input.getNumSamples() + tailLength );
+    int written = 0;
+    renderer.run( input.getNumSamples(), tailLength,
+                 [ & ]( juce::AudioBuffer< float >& buffer, juce::int64 position, int numSamples )
+                 {
+                     for ( int channel = 0; channel < numInputs; channel++ )
+                     {
+                         auto& source = channel < numChannels ? input : sidechain;
+                         buffer.copyFrom( channel, 0, source, channel < numChannels ? channel : channel - numChannels, (int)position, numSamples );
+                     }
+                 },
+                 [ & ]( const juce::AudioBuffer< float >& buffer, int startSample, int numSamples )
+                 {
+                     for ( int channel = 0; channel < numOutputs; channel++ ) { output.copyFrom( channel, written, buffer, channel, startSample, numSamples ); }
+                     written += numSamples;
+                     if ( afterBlock ) { afterBlock( renderer.getProcessor() ); }
+                     return true;
+                 },
+                 [ & ]( juce::MidiBuffer& midi, juce::int64 position, int numSamples )
+                 {
+                     if ( settings.midi ) { addMidiEvents( midi, sampleRate, position, numSamples ); }
+                 } );
+   #if ! SJF_BASELINE_REFERENCES
+    sjf_qualityGovernor::setOverride( -1 );
+   #endif
+    return output;
+}
+
+//==============================================================================
+// peak difference relative to the reference's peak in dB, -inf when they are identical and +inf when they can't be compared
+static double compare( const juce::AudioBuffer< float >& output, const juce::AudioBuffer< float >& reference )
+{
+    if ( output.getNumChannels() != reference.getNumChannels() || output.getNumSamples() != reference.getNumSamples() ) { return std::numeric_limits< double >::infinity(); }
+    double difference = 0.0, peak = 0.0;
+    for ( int channel = 0; channel < output.getNumChannels(); channel++ )
+    {
+        auto* a = output.getReadPointer( channel );
+        auto* b = reference.getReadPointer( channel );
+        for ( int i = 0; i < output.getNumSamples(); i++ )
+        {
+            if ( !std::isfinite( a[ i ] ) ) { return std::numeric_limits< double >::infinity(); }
+            difference = std::max( difference, (double)std::abs( a[ i ] - b[ i ] ) );
+            peak = std::max( peak, (double)std::abs( b[ i ] ) );
+        }
+    }
+    if ( difference == 0.0 ) { return -std::numeric_limits< double >::infinity(); }
+    return 20.0 * std::log10( difference / std::max( peak, 1e-9 ) );
+}
+
+//==============================================================================
+// difference in overall level in dB, for renders that can only be compared statistically
+static double compareLevels( const juce::AudioBuffer< float >& output, const juce::AudioBuffer< float >& reference )
+{
+    if ( output.getNumChannels() != reference.getNumChannels() ) { return std::numeric_limits< double >::infinity(); }
+    double difference = 0.0;
+    for ( int channel = 0; channel < output.getNumChannels(); channel++ )
+    {
+        auto a = output.getRMSLevel( channel, 0, output.getNumSamples() ), b = reference.getRMSLevel( channel, 0, reference.getNumSamples() );
+        difference = std::max( difference, (double)std::abs( juce::Decibels::gainToDecibels( a, -200.0f ) - juce::Decibels::gainToDecibels( b, -200.0f ) ) );
+    }
+    return difference;
+}
+
+//==============================================================================
+// returns a description of the first bad sample, or an empty string if there isn't one
+static juce::String findBadValue( const juce::AudioBuffer< float >& buffer )
+{
+    for ( int channel = 0; channel < buffer.getNumChannels(); channel++ )
+    {
+        auto* samples = buffer.getReadPointer( channel );
+        for ( int i = 0; i < buffer.getNumSamples(); i++ )
+        {
+            if ( !std::isfinite( samples[ i ] ) ) { return "non finite sample at " + juce::String( i ) + " on channel " + juce::String( channel ); }
+            if ( samples[ i ] != 0.0f && std::abs( samples[ i ] ) < std::numeric_limits< float >::min() ) { return "denormal at " + juce::String( i ) + " on channel " + juce::String( channel ); }
+        }
+    }
+    return {};
+}
+
+//==============================================================================
+static juce::String describe( const double dB )
+{
+    if ( dB == -std::numeric_limits< double >::infinity() ) { return "identical"; }
+    if ( dB == std::numeric_limits< double >::infinity() ) { return "different lengths or non finite"; }
+    return juce::String( dB, 1 ) + "dB";
+}
+
+//==============================================================================
+class testRunner
+{
+public:
+    testRunner( const juce::File& referenceDirectory, const bool updateReferences, const juce::String& filter )
+        : m_referenceDirectory( referenceDirectory ), m_updateReferences( updateReferences ), m_filter( filter )
+    {
+        m_formatManager.registerBasicFormats();
+    }
+    //==============================================================================
+    bool wants( const juce::String& name ) const { return m_filter.isEmpty() || name.contains( m_filter ); }
+    //==============================================================================
+    void check( const juce::String& name, const bool passed, const juce::String& detail )
+    {
+        ( passed ? m_numPassed : m_numFailed )++;
+        std::cout << ( passed ? "pass  " : "FAIL  " ) << name << "  ( " << detail << " )" << std::endl;
+    }
+    //==============================================================================
+    void checkReference( const testSettings& settings, const bool offline = false )
+    {
+        const auto name = "reference/" + settings.getName() + ( offline ? "-render-profile" : "" );
+        if ( !wants( name ) ) { return; }
+       #if SJF_BASELINE_REFERENCES
+        // the original plugin can't play the rest
+        if ( !settings.existsInBaseline() ) { return; }
+       #else
+        // those references are the original plugin's and only ever come from it
+        if ( m_updateReferences && settings.existsInBaseline() ) { return; }
+       #endif
+        auto output = render( settings, makeState( settings ), makeTestSignal( REFERENCE_SAMPLE_RATE, 2 ), REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE, offline );
+        auto file = m_referenceDirectory.getChildFile( name.fromFirstOccurrenceOf( "/", false, false ) + ".wav" );
+        if ( m_updateReferences )
+        {
+            check( name, writeReference( file, output ), "written to " + file.getFileName() );
+            return;
+        }
+        juce::AudioBuffer< float > reference;
+        if ( !readReference( file, reference ) )
+        {
+            check( name, false, "no reference render, they are made by the references workflow ( see the readme )" );
+            return;
+        }
+        if ( !settings.isDeterministic() )
+        {
+            auto dB = compareLevels( output, reference );
+            check( name, dB <= STATISTICAL_TOLERANCE_DB, "level within " + juce::String( dB, 2 ) + "dB" );
+            return;
+        }
+        auto dB = compare( output, reference );
+        check( name, dB <= ( settings.hasFeedback() ? FEEDBACK_REFERENCE_TOLERANCE_DB : REFERENCE_TOLERANCE_DB ), describe( dB ) );
+    }
+    //==============================================================================
+    void checkBlockSizes( const testSettings& settings )
+    {
+        for ( auto sampleRate : { 44100.0, 48000.0, 96000.0 } )
+        {
+            const auto name = "block size/" + settings.getName() + "-" + juce::String( sampleRate / 1000.0, 1 ) + "kHz";
+            if ( !wants( name ) ) { continue; }
+            auto state = makeState( settings );
+            auto input = makeTestSignal( sampleRate, 2 );
+            auto reference = render( settings, state, input, sampleRate, REFERENCE_BLOCK_SIZE );
+            double worst = -std::numeric_limits< double >::infinity();
+            int worstBlockSize = 0;
+            for ( auto blockSize : { 1, 7, 64, 333, 4096 } )
+            {
+                // a sample at a time is slow, once is enough
+                if ( blockSize == 1 && sampleRate != REFERENCE_SAMPLE_RATE ) { continue; }
+                auto dB = compare( render( settings, state, input, sampleRate, blockSize ), reference );
+                if ( dB > worst ) { worst = dB; worstBlockSize = blockSize; }
+            }
+            check( name, worst <= INVARIANCE_TOLERANCE_DB, worstBlockSize == 0 ? "identical" : "worst " + describe( worst ) + " at " + juce::String( worstBlockSize ) );
+        }
+    }
+    //==============================================================================
+   #if ! SJF_BASELINE_REFERENCES
+    void checkDispatchLevels( const testSettings& settings )
+    {
+        const auto name = "dispatch/" + settings.getName();
+        if ( !wants( name ) ) { return; }
+        auto state = makeState( settings );
+        auto input = makeTestSignal( REFERENCE_SAMPLE_RATE, 2 );
+        sjf_cpuDispatch::setOverride( sjf_cpuDispatch::baseline );
+        auto baseline = render( settings, state, input, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE );
+        juce::String detail = "baseline only";
+        bool passed = true;
+        for ( int level = sjf_cpuDispatch::baseline + 1; level <= sjf_cpuDispatch::getDetectedLevel(); level++ )
+        {
+            sjf_cpuDispatch::setOverride( level );
+            auto dB = compare( render( settings, state, input, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE ), baseline );
+            // no fma and no fast math, so every level should be bit for bit the same
+            passed &= dB == -std::numeric_limits< double >::infinity();
+            detail = ( level == sjf_cpuDispatch::baseline + 1 ? juce::String() : detail + ", " ) + sjf_cpuDispatch::getLevelName( level ) + " " + describe( dB );
+        }
+        sjf_cpuDispatch::setOverride( -1 );
+        check( name, passed, detail );
+    }
+    //==============================================================================
+    void checkBadValues( const testSettings& settings )
+    {
+        for ( auto offline : { false, true } )
+        {
+            const auto name = "bad values/" + settings.getName() + ( offline ? "-render-profile" : "" );
+            if ( !wants( name ) ) { continue; }
+            // nans and infs in the noise, then a stretch of values too small to be normal floats and a long silence to decay into
+            auto input = makeTestSignal( REFERENCE_SAMPLE_RATE, 2 );
+            const int length = input.getNumSamples();
+            for ( int channel = 0; channel < 2; channel++ )
+            {
+                auto* samples = input.getWritePointer( channel );
+                samples[ length - 4000 ] = std::numeric_limits< float >::quiet_NaN();
+                samples[ length - 3000 ] = std::numeric_limits< float >::infinity();
+                samples[ length - 2000 ] = -std::numeric_limits< float >::infinity();
+                for ( int i = length / 16; i < length / 8; i++ ) { samples[ i ] = ( i & 1 ? 1.0f : -1.0f ) * 1.0e-40f; }
+            }
+            auto output = render( settings, makeState( settings ), input, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE, offline );
+            auto bad = findBadValue( output );
+            check( name, bad.isEmpty(), bad.isEmpty() ? juce::String( "all finite and normal" ) : bad );
+        }
+    }
+    //==============================================================================
+    void checkDualMono( const testSettings& settings )
+    {
+        const auto name = "dual mono/" + settings.getName();
+        if ( !wants( name ) ) { return; }
+        auto state = makeState( settings );
+        auto mono = makeTestSignal( REFERENCE_SAMPLE_RATE, 1 );
+        auto other = makeTestSignal( REFERENCE_SAMPLE_RATE, 2 );
+
+        // the same on both channels all the way through, so they are linked once the tail has been identical for long enough
+        juce::AudioBuffer< float > identical( 2, mono.getNumSamples() * 2 );
+        for ( int channel = 0; channel < 2; channel++ )
+        {
+            identical.copyFrom( channel, 0, mono, 0, 0, mono.getNumSamples() );
+            identical.copyFrom( channel, mono.getNumSamples(), mono, 0, 0, mono.getNumSamples() );
+        }
+        auto identicalOutput = render( settings, state, identical, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE );
+        auto channelsDB = compareChannels( identicalOutput, 0, identicalOutput, 1 );
+
+        // then the second channel changes half way, it has to carry on from state caught up from the first
+        auto diverging = identical;
+        diverging.copyFrom( 1, mono.getNumSamples(), other, 1, 0, mono.getNumSamples() );
+        auto divergingOutput = render( settings, state, diverging, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE );
+        // which should be the same as processing that channel on its own
+        juce::AudioBuffer< float > secondChannel( 1, diverging.getNumSamples() );
+        secondChannel.copyFrom( 0, 0, diverging, 1, 0, diverging.getNumSamples() );
+        auto aloneOutput = render( settings, state, secondChannel, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE );
+        auto divergedDB = compareChannels( divergingOutput, 1, aloneOutput, 0 );
+
+        check( name, channelsDB <= INVARIANCE_TOLERANCE_DB && divergedDB <= INVARIANCE_TOLERANCE_DB, "identical channels " + describe( channelsDB ) + ", diverged channel against mono " + describe( divergedDB ) );
+    }
+    //==============================================================================
+    void checkStaticChain( const testSettings& settings )
+    {
+        const auto name = "static chain/" + settings.getName();
+        if ( !wants( name ) ) { return; }
+        auto state = makeState( settings );
+        auto input = makeTestSignal( REFERENCE_SAMPLE_RATE, 2 );
+        auto bands = render( settings, state, input, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE );
+        // the kernel is built on the message thread, so it has to be given the chance between blocks
+        bool kernelRan = false;
+        auto pumped = render( settings, state, input, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE, false, [ &kernelRan ]( processor& audioProcessor )
+        {
+            juce::MessageManager::getInstance()->runDispatchLoopUntil( 1 );
+            kernelRan |= audioProcessor.isStaticKernelRunning();
+        } );
+        auto dB = compare( pumped, bands );
+        // the kernel is only used where it times cheaper than the bands, either way the output mustn't change
+        check( name, dB <= STATIC_TOLERANCE_DB, describe( dB ) + ( kernelRan ? ", kernel used" : ", kernel not used on this machine" ) );
+    }
+   #endif
+    //==============================================================================
+    void checkAuxHoldsMultirate( testSettings settings )
+    {
+        const auto name = "aux/" + settings.getName();
+        if ( !wants( name ) ) { return; }
+        auto input = makeTestSignal( REFERENCE_SAMPLE_RATE, 2 );
+        settings.multirate = false;
+        auto plain = render( settings, makeState( settings ), input, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE );
+        settings.multirate = true;
+        auto dB = compare( render( settings, makeState( settings ), input, REFERENCE_SAMPLE_RATE, REFERENCE_BLOCK_SIZE ), plain );
+        check( name, dB <= INVARIANCE_TOLERANCE_DB, "multirate asked for against off " + describe( dB ) );
+    }
+    //==============================================================================
+    int getNumFailed() const { return m_numFailed; }
+    int getNumPassed() const { return m_numPassed; }
+    //==============================================================================
+private:
+    static double compareChannels( const juce::AudioBuffer< float >& a, const int channelA, const juce::AudioBuffer< float >& b, const int channelB )
+    {
+        juce::AudioBuffer< float > first( 1, a.getNumSamples() ), second( 1, b.getNumSamples() );
+        first.copyFrom( 0, 0, a, channelA, 0, a.getNumSamples() );
+        second.copyFrom( 0, 0, b, channelB, 0, b.getNumSamples() );
+        return compare( first, second );
+    }
+    //==============================================================================
+    bool writeReference( const juce::File& file, const juce::AudioBuffer< float >& output )
+    {
+        if ( !m_referenceDirectory.createDirectory() ) { return false; }
+        file.deleteFile();
+        auto stream = file.createOutputStream();
+        if ( stream == nullptr ) { return false; }
+        juce::WavAudioFormat wav;
+        std::unique_ptr< juce::AudioFormatWriter > writer( wav.createWriterFor( stream.get(), REFERENCE_SAMPLE_RATE, (unsigned int)output.getNumChannels(), 32, {}, 0 ) );
+        if ( writer == nullptr ) { return false; }
+        stream.release(); // the writer owns it now
+        return writer->writeFromAudioSampleBuffer( output, 0, output.getNumSamples() );
+    }
+    //==============================================================================
+    bool readReference( const juce::File& file, juce::AudioBuffer< float >& reference )
+    {
+        std::unique_ptr< juce::AudioFormatReader > reader( m_formatManager.createReaderFor( file ) );
+        if ( reader == nullptr ) { return false; }
+        reference.setSize( (int)reader->numChannels, (int)reader->lengthInSamples );
+        return reader->read( &reference, 0, (int)reader->lengthInSamples, 0, true, true );
+    }
+    //==============================================================================
+    juce::AudioFormatManager m_formatManager;
+    const juce::File m_referenceDirectory;
+    const bool m_updateReferences;
+    const juce::String m_filter;
+    int m_numPassed = 0, m_numFailed = 0;
+};
+
+//==============================================================================
+int main( int argc, char* argv[] )
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    auto referenceDirectory = juce::File::getCurrentWorkingDirectory().getChildFile( "References" );
+    bool updateReferences = false;
+    juce::String filter;
+    for ( int i = 1; i < argc; i++ )
+    {
+        juce::String argument( argv[ i ] );
+        auto hasValue = i + 1 < argc;
+        if ( argument == "--references" && hasValue ) { referenceDirectory = juce::File::getCurrentWorkingDirectory().getChildFile( argv[ ++i ] ); }
+        else if ( argument == "--update-references" ) { updateReferences = true; }
+        else if ( argument == "--filter" && hasValue ) { filter = argv[ ++i ]; }
+        else
+        {
+            std::cerr << "usage: sjf_spectralTests [--references <directory>] [--update-references] [--filter <text>]" << std::endl;
+            return 1;
+        }
+    }
+
+    testRunner runner( referenceDirectory, updateReferences, filter );
+
+    // every design, order and band mode through the plain filters
+    std::vector< testSettings > matrix;
+    for ( int design = 1; design <= 3; design++ )
+    {
+        for ( auto order : { 2, 4, 8 } )
+        {
+            for ( int bands = 1; bands <= 3; bands++ )
+            {
+                testSettings settings;
+                settings.filterDesign = design;
+                settings.filterOrder = order;
+                settings.bands = bands;
+                matrix.push_back( settings );
+            }
+        }
+    }
+    // multirate with each design
+    for ( int design = 1; design <= 3; design++ )
+    {
+        testSettings settings;
+        settings.filterDesign = design;
+        settings.filterOrder = 8;
+        settings.multirate = true;
+        matrix.push_back( settings );
+    }
+    // both lfo types
+    for ( int lfoType = 1; lfoType <= 2; lfoType++ )
+    {
+        testSettings settings;
+        settings.lfos = true;
+        settings.lfoType = lfoType;
+        matrix.push_back( settings );
+    }
+    // every delay interpolation and storage format, with feedback
+    for ( int interpolation = 1; interpolation <= 4; interpolation++ )
+    {
+        for ( int storage = 1; storage <= 4; storage++ )
+        {
+            testSettings settings;
+            settings.delays = true;
+            settings.delayInterpolation = interpolation;
+            settings.delayStorage = storage;
+            matrix.push_back( settings );
+        }
+    }
+    // every feedback matrix, the custom one is scaled down to a gain of 1 when it is set
+    for ( int matrixType = 2; matrixType <= 4; matrixType++ )
+    {
+        testSettings settings;
+        settings.delays = true;
+        settings.feedbackMatrix = matrixType;
+        matrix.push_back( settings );
+    }
+    // longer delays than the default, then a memory budget too small for them and one too small for the default
+    testSettings longDelays, overBudget, smallBudget;
+    longDelays.delays = overBudget.delays = smallBudget.delays = true;
+    longDelays.maxDelayTime = 2.0f;
+    overBudget.maxDelayTime = 8.0f;
+    overBudget.delayMemory = smallBudget.delayMemory = 1;
+    smallBudget.delayStorage = 2;
+    for ( auto& settings : { longDelays, overBudget, smallBudget } ) { matrix.push_back( settings ); }
+    // both dynamics modes with both detectors, then the envelope driving the lfo depths and the feedback
+    for ( int mode = 2; mode <= 3; mode++ )
+    {
+        for ( int detector = 1; detector <= 2; detector++ )
+        {
+            testSettings settings;
+            settings.dynamicsMode = mode;
+            settings.dynamicsDetector = detector;
+            matrix.push_back( settings );
+        }
+    }
+    testSettings lfoEnvelope, feedbackEnvelope;
+    lfoEnvelope.dynamicsMode = feedbackEnvelope.dynamicsMode = 2;
+    lfoEnvelope.lfos = true;
+    lfoEnvelope.envelopeTarget = 2;
+    feedbackEnvelope.delays = true;
+    feedbackEnvelope.envelopeTarget = 3;
+    for ( auto& settings : { lfoEnvelope, feedbackEnvelope } ) { matrix.push_back( settings ); }
+    // the vocoder with the sidechain on, in the plain and the octave bands
+    for ( int bands = 1; bands <= 3; bands += 2 )
+    {
+        testSettings settings;
+        settings.vocoder = true;
+        settings.bands = bands;
+        matrix.push_back( settings );
+    }
+    // every aux routing
+    for ( int routing = 1; routing <= 4; routing++ )
+    {
+        testSettings settings;
+        settings.auxBuses = true;
+        settings.auxRouting = routing;
+        matrix.push_back( settings );
+    }
+    // midi landing part way through blocks, with the delays and lfos running so the recalls change them too
+    testSettings midi;
+    midi.midi = midi.delays = midi.lfos = true;
+    matrix.push_back( midi );
+    // every level the governor can step down to, with the settings it cuts back
+    for ( int level = 1; level <= 3; level++ )
+    {
+        testSettings settings;
+        settings.governorLevel = level;
+        settings.filterOrder = 8;
+        settings.bands = 2;
+        settings.lfos = settings.delays = true;
+        settings.delayInterpolation = 4;
+        matrix.push_back( settings );
+    }
+    // everything at once, multirate included
+    testSettings everything;
+    everything.filterDesign = 3;
+    everything.filterOrder = 8;
+    everything.multirate = everything.lfos = everything.delays = true;
+    everything.delayInterpolation = 4;
+    everything.delayStorage = 2;
+    matrix.push_back( everything );
+
+    for ( auto& settings : matrix ) { runner.checkReference( settings ); }
+    runner.checkReference( everything, true );
+   #if ! SJF_BASELINE_REFERENCES
+    if ( !updateReferences )
+    {
+        testSettings plain, delays, multirate, householder, compressor, vocoder, aux;
+        delays.delays = householder.delays = true;
+        multirate.multirate = true;
+        multirate.filterOrder = 8;
+        householder.feedbackMatrix = 2;
+        compressor.dynamicsMode = 2;
+        compressor.dynamicsDetector = 2;
+        vocoder.vocoder = true;
+        aux.auxBuses = true;
+        aux.auxRouting = 2;
+        for ( auto& settings : { plain, multirate, delays, everything, householder, overBudget, compressor, vocoder, aux, midi } )
+        {
+            runner.checkBlockSizes( settings );
+            runner.checkDispatchLevels( settings );
+            runner.checkBadValues( settings );
+        }
+        for ( auto& settings : { plain, multirate, delays } ) { runner.checkDualMono( settings ); }
+        testSettings chebyshev;
+        chebyshev.filterDesign = 3;
+        chebyshev.filterOrder = 8;
+        for ( auto& settings : { plain, chebyshev } ) { runner.checkStaticChain( settings ); }
+        runner.checkAuxHoldsMultirate( aux );
+    }
+   #endif
+
+    std::cout << runner.getNumPassed() << " passed, " << runner.getNumFailed() << " failed" << std::endl;
+    return runner.getNumFailed() > 0 ? 1 : 0;
+}